@@ -7,6 +7,27 @@
 #include <chrono>
 #include <stdexcept> // For runtime_error
 #include <cmath>     // For fabs, sin, cos
+#include <cstdlib>   // For strtoul
+#include <cstring>   // For strcmp
+#include <cstdio>    // For sscanf
+#include <mutex>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <complex>
+#include <random>
+#include <fstream>
+#include <atomic>
+#include <csignal>
+#include <functional>
+#include <sys/resource.h> // getrusage for the peak RSS report
+#include <sys/mman.h>     // mmap/madvise for the pinned host pool
+#include <sys/syscall.h>  // mbind without a libnuma dependency
+#include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
+#include <linux/io_uring.h> // Stream mode talks to io_uring through raw syscalls
+#include <sys/wait.h>
 
 // Note: The "[unknown]" engine in intel_gpu_top for OpenCL compute workloads is common.
 // This load generator aims to stress the GPU's execution units.
@@ -26,102 +47,5369 @@ __kernel void load_kernel(__global float* data, const int count) {
         data[id] = val;
     }
 }
+
+// Fills the load buffer with the same starting values the host used to upload.
+__kernel void load_init(__global float* data, const int count) {
+    int id = get_global_id(0);
+    if (id < count) data[id] = (float)(id % 100) + 0.1f;
+}
+)";
+
+// Memory access pattern kernels. Every pattern moves the same number of elements so the
+// effective bandwidth numbers are directly comparable; only the address stream changes.
+// `count` is always a power of two so the index mixing below stays a permutation.
+const char* accessKernelSource = R"(
+// Invertible hash on the low `bits` bits: odd multiplies and xor-shifts are both bijective
+// modulo 2^bits, so this yields a random-looking permutation without a host-side shuffle.
+uint permute_index(uint x, uint bits) {
+    uint mask = (bits >= 32) ? 0xffffffffu : ((1u << bits) - 1u);
+    uint half_bits = bits / 2 + 1;
+    x = (x * 0x9E3779B1u) & mask;
+    x ^= x >> half_bits;
+    x = (x * 0x85EBCA6Bu) & mask;
+    x ^= x >> half_bits;
+    x = (x * 0xC2B2AE35u) & mask;
+    return x;
+}
+
+__kernel void access_init(__global float* data, __global uint* indices, const uint count, const uint bits) {
+    uint id = get_global_id(0);
+    if (id < count) {
+        data[id] = (float)(id % 100) + 0.1f;
+        indices[id] = permute_index(id, bits);
+    }
+}
+
+__kernel void access_stride(__global const float* restrict src, __global float* restrict dst,
+                            const uint count, const uint stride) {
+    uint id = get_global_id(0);
+    if (id < count) {
+        // Neighbouring work-items read `stride` elements apart; the wrap keeps this a permutation.
+        uint rows = count / stride;
+        uint idx = (id % rows) * stride + id / rows;
+        dst[id] = src[idx];
+    }
+}
+
+__kernel void access_gather(__global const float* restrict src, __global float* restrict dst,
+                            __global const uint* restrict indices, const uint count) {
+    uint id = get_global_id(0);
+    if (id < count) {
+        dst[id] = src[indices[id]];
+    }
+}
+
+__kernel void access_scatter(__global const float* restrict src, __global float* restrict dst,
+                             __global const uint* restrict indices, const uint count) {
+    uint id = get_global_id(0);
+    if (id < count) {
+        dst[indices[id]] = src[id];
+    }
+}
+
+// 2D variants treat the buffer as a width x height row-major matrix and are launched with
+// square work-groups of up to 16 x 16. The naive transpose writes a column per group row, so
+// its stores are strided by `height`.
+__kernel void access_transpose2d(__global const float* restrict src, __global float* restrict dst,
+                                 const uint width, const uint height) {
+    uint x = get_global_id(0);
+    uint y = get_global_id(1);
+    dst[x * height + y] = src[y * width + x];
+}
+
+// The same transpose through a __local tile: the group reads its tile row by row, swaps it in
+// local memory (padded by one column so the transposed reads do not hit one bank), and writes
+// the destination tile row by row too, so both sides of global traffic are contiguous.
+__kernel void access_transpose2d_local(__global const float* restrict src, __global float* restrict dst,
+                                       const uint width, const uint height) {
+    __local float tile[16][17];
+    uint lx = get_local_id(0);
+    uint ly = get_local_id(1);
+    uint size = get_local_size(0);
+    tile[ly][lx] = src[get_global_id(1) * width + get_global_id(0)];
+    barrier(CLK_LOCAL_MEM_FENCE);
+    uint x = get_group_id(1) * size + lx; // Destination column = source row
+    uint y = get_group_id(0) * size + ly; // Destination row = source column
+    dst[y * height + x] = tile[lx][ly];
+}
+)";
+
+// Local (shared) memory kernels. LOCAL_ELEMS (a power of two) and MAX_WG are supplied as
+// build options so the arrays can be sized to the device.
+const char* localMemKernelSource = R"(
+// Lanes read addresses `stride` words apart. Intel and most other GPUs bank local memory in
+// 4-byte words, so strides sharing factors with the bank count serialise into conflicts.
+__kernel void local_bandwidth(__global float* out, const uint stride, const uint iterations) {
+    __local float tile[LOCAL_ELEMS];
+    uint lid = get_local_id(0);
+    for (uint i = lid; i < LOCAL_ELEMS; i += get_local_size(0)) tile[i] = (float)i;
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    float acc = 0.0f;
+    uint base = lid * stride;
+    #pragma unroll 8
+    for (uint i = 0; i < iterations; ++i) {
+        acc += tile[(base + i) & (LOCAL_ELEMS - 1)];
+    }
+    out[get_global_id(0)] = acc;
+}
+
+// A single work-item per group follows a pointer chain through local memory, so every load
+// depends on the previous one and the time per hop is the load-to-use latency.
+__kernel void local_latency(__global uint* out, const uint iterations, const uint step) {
+    __local uint chain[LOCAL_ELEMS];
+    for (uint i = get_local_id(0); i < LOCAL_ELEMS; i += get_local_size(0)) {
+        chain[i] = (i + step) & (LOCAL_ELEMS - 1);
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+    if (get_local_id(0) == 0) {
+        uint p = 0;
+        for (uint i = 0; i < iterations; ++i) p = chain[p];
+        out[get_group_id(0)] = p;
+    }
+}
+
+// The same local store/load loop with and without barriers; the time difference is the barrier
+// cost. Without a barrier a neighbour's slot would be a data race, so local_no_barrier reads back
+// its own slot, through a volatile pointer so the compiler cannot forward the store.
+__kernel void local_barrier(__global float* out, const uint iterations) {
+    __local float slot[MAX_WG];
+    uint lid = get_local_id(0);
+    uint lsize = get_local_size(0);
+    float v = (float)lid;
+    for (uint i = 0; i < iterations; ++i) {
+        slot[lid] = v;
+        barrier(CLK_LOCAL_MEM_FENCE);
+        v += slot[(lid + 1) % lsize] * 0.5f;
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+    out[get_global_id(0)] = v;
+}
+
+__kernel void local_no_barrier(__global float* out, const uint iterations) {
+    __local float slot[MAX_WG];
+    volatile __local float* own = slot;
+    uint lid = get_local_id(0);
+    float v = (float)lid;
+    for (uint i = 0; i < iterations; ++i) {
+        own[lid] = v;
+        v += own[lid] * 0.5f;
+    }
+    out[get_global_id(0)] = v;
+}
+)";
+
+// Atomic contention kernels. Work-item `gid` always hits target `gid % targets`, so
+// targets == 1 is a single hot address and targets >= the NDRange is fully spread.
+// OpenCL 1.2 has no float atomics, so the float variants use the usual compare-and-swap loop
+// on the bit pattern; that is also what our histogram kernels compile down to today. Devices
+// with cl_ext_float_atomics get the native variants below as well.
+const char* atomicKernelSource = R"(
+void atomic_add_float_global(volatile __global float* addr, float value) {
+    union { uint u; float f; } expected, desired;
+    do {
+        expected.f = *addr;
+        desired.f = expected.f + value;
+    } while (atomic_cmpxchg((volatile __global uint*)addr, expected.u, desired.u) != expected.u);
+}
+
+void atomic_add_float_local(volatile __local float* addr, float value) {
+    union { uint u; float f; } expected, desired;
+    do {
+        expected.f = *addr;
+        desired.f = expected.f + value;
+    } while (atomic_cmpxchg((volatile __local uint*)addr, expected.u, desired.u) != expected.u);
+}
+
+__kernel void atomic_global_int(__global int* bins, const uint targets, const uint iterations) {
+    __global int* target = bins + get_global_id(0) % targets;
+    for (uint i = 0; i < iterations; ++i) atomic_add(target, 1);
+}
+
+__kernel void atomic_global_float(__global float* bins, const uint targets, const uint iterations) {
+    __global float* target = bins + get_global_id(0) % targets;
+    for (uint i = 0; i < iterations; ++i) atomic_add_float_global(target, 1.0f);
+}
+
+// Privatised variants: contention happens on per-group __local bins, which are merged into
+// the global bins once per group at the end, as a privatised histogram would do.
+__kernel void atomic_local_int(__global int* bins, const uint targets, const uint iterations) {
+    __local int local_bins[LOCAL_BINS];
+    uint lid = get_local_id(0);
+    for (uint b = lid; b < targets; b += get_local_size(0)) local_bins[b] = 0;
+    barrier(CLK_LOCAL_MEM_FENCE);
+    __local int* target = local_bins + lid % targets;
+    for (uint i = 0; i < iterations; ++i) atomic_add(target, 1);
+    barrier(CLK_LOCAL_MEM_FENCE);
+    for (uint b = lid; b < targets; b += get_local_size(0)) atomic_add(&bins[b], local_bins[b]);
+}
+
+__kernel void atomic_local_float(__global float* bins, const uint targets, const uint iterations) {
+    __local float local_bins[LOCAL_BINS];
+    uint lid = get_local_id(0);
+    for (uint b = lid; b < targets; b += get_local_size(0)) local_bins[b] = 0.0f;
+    barrier(CLK_LOCAL_MEM_FENCE);
+    __local float* target = local_bins + lid % targets;
+    for (uint i = 0; i < iterations; ++i) atomic_add_float_local(target, 1.0f);
+    barrier(CLK_LOCAL_MEM_FENCE);
+    for (uint b = lid; b < targets; b += get_local_size(0)) atomic_add_float_global(&bins[b], local_bins[b]);
+}
+)";
+
+// Native float add from cl_ext_float_atomics, appended to atomicKernelSource and built as
+// OpenCL C 2.0+. NATIVE_GLOBAL_ADD / NATIVE_LOCAL_ADD follow the device's reported capabilities.
+const char* atomicNativeFloatKernelSource = R"(
+#ifdef NATIVE_GLOBAL_ADD
+__kernel void atomic_global_float_native(__global float* bins, const uint targets, const uint iterations) {
+    volatile __global atomic_float* target = (volatile __global atomic_float*)(bins + get_global_id(0) % targets);
+    for (uint i = 0; i < iterations; ++i) atomic_fetch_add_explicit(target, 1.0f, memory_order_relaxed);
+}
+#endif
+
+#ifdef NATIVE_LOCAL_ADD
+__kernel void atomic_local_float_native(__global float* bins, const uint targets, const uint iterations) {
+    __local float local_bins[LOCAL_BINS];
+    uint lid = get_local_id(0);
+    for (uint b = lid; b < targets; b += get_local_size(0)) local_bins[b] = 0.0f;
+    barrier(CLK_LOCAL_MEM_FENCE);
+    volatile __local atomic_float* target = (volatile __local atomic_float*)(local_bins + lid % targets);
+    for (uint i = 0; i < iterations; ++i) atomic_fetch_add_explicit(target, 1.0f, memory_order_relaxed, memory_scope_work_group);
+    barrier(CLK_LOCAL_MEM_FENCE);
+    for (uint b = lid; b < targets; b += get_local_size(0)) {
+#ifdef NATIVE_GLOBAL_ADD
+        atomic_fetch_add_explicit((volatile __global atomic_float*)&bins[b], local_bins[b], memory_order_relaxed);
+#else
+        atomic_add_float_global(&bins[b], local_bins[b]);
+#endif
+    }
+}
+#endif
+)";
+
+// Subgroup kernels, each paired with a __local memory implementation of the same operation
+// over subgroup-sized segments so the two produce the same values. SG_SIZE, when defined,
+// pins the compiled SIMD width through cl_intel_required_subgroup_size; WG is the group size.
+const char* subgroupKernelSource = R"(
+#ifdef SG_SIZE
+#define SG_ATTR __attribute__((intel_reqd_sub_group_size(SG_SIZE)))
+#else
+#define SG_ATTR
+#endif
+
+SG_ATTR __kernel void sg_reduce(__global const float* in, __global float* out, const uint iterations) {
+    float inv_n = 1.0f / get_sub_group_size();
+    float lane = (float)get_sub_group_local_id();
+    float v = in[get_global_id(0)];
+    for (uint i = 0; i < iterations; ++i) v = sub_group_reduce_add(v) * inv_n + lane * 0.001f;
+    out[get_global_id(0)] = v;
+}
+
+SG_ATTR __kernel void local_reduce(__global const float* in, __global float* out, const uint iterations) {
+    __local float slots[WG];
+    uint lid = get_local_id(0);
+    uint n = get_sub_group_size();
+    uint lane = get_sub_group_local_id();
+    uint base = lid - lane;
+    float inv_n = 1.0f / n;
+    float v = in[get_global_id(0)];
+    for (uint i = 0; i < iterations; ++i) {
+        slots[lid] = v;
+        barrier(CLK_LOCAL_MEM_FENCE);
+        for (uint offset = n / 2; offset > 0; offset /= 2) {
+            if (lane < offset) slots[lid] += slots[lid + offset];
+            barrier(CLK_LOCAL_MEM_FENCE);
+        }
+        v = slots[base] * inv_n + (float)lane * 0.001f;
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+    out[get_global_id(0)] = v;
+}
+
+SG_ATTR __kernel void sg_scan(__global const float* in, __global float* out, const uint iterations) {
+    float inv_n = 1.0f / get_sub_group_size();
+    float v = in[get_global_id(0)];
+    for (uint i = 0; i < iterations; ++i) v = sub_group_scan_inclusive_add(v) * inv_n;
+    out[get_global_id(0)] = v;
+}
+
+SG_ATTR __kernel void local_scan(__global const float* in, __global float* out, const uint iterations) {
+    __local float slots[WG];
+    uint lid = get_local_id(0);
+    uint n = get_sub_group_size();
+    uint lane = get_sub_group_local_id();
+    float inv_n = 1.0f / n;
+    float v = in[get_global_id(0)];
+    for (uint i = 0; i < iterations; ++i) {
+        // Hillis-Steele inclusive scan within each segment
+        slots[lid] = v;
+        barrier(CLK_LOCAL_MEM_FENCE);
+        for (uint offset = 1; offset < n; offset *= 2) {
+            float add = lane >= offset ? slots[lid - offset] : 0.0f;
+            barrier(CLK_LOCAL_MEM_FENCE);
+            slots[lid] += add;
+            barrier(CLK_LOCAL_MEM_FENCE);
+        }
+        v = slots[lid] * inv_n;
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+    out[get_global_id(0)] = v;
+}
+
+SG_ATTR __kernel void sg_broadcast(__global const float* in, __global float* out, const uint iterations) {
+    uint n = get_sub_group_size();
+    float lane = (float)get_sub_group_local_id();
+    float v = in[get_global_id(0)];
+    for (uint i = 0; i < iterations; ++i) v = sub_group_broadcast(v, i % n) * 0.5f + lane * 0.001f;
+    out[get_global_id(0)] = v;
+}
+
+SG_ATTR __kernel void local_broadcast(__global const float* in, __global float* out, const uint iterations) {
+    __local float slots[WG];
+    uint lid = get_local_id(0);
+    uint n = get_sub_group_size();
+    uint lane = get_sub_group_local_id();
+    uint base = lid - lane;
+    float v = in[get_global_id(0)];
+    for (uint i = 0; i < iterations; ++i) {
+        slots[lid] = v;
+        barrier(CLK_LOCAL_MEM_FENCE);
+        v = slots[base + i % n] * 0.5f + (float)lane * 0.001f;
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+    out[get_global_id(0)] = v;
+}
+
+#ifdef HAS_INTEL_SUBGROUPS
+SG_ATTR __kernel void sg_shuffle(__global const float* in, __global float* out, const uint iterations) {
+    uint n = get_sub_group_size();
+    uint next = (get_sub_group_local_id() + 1) % n;
+    float v = in[get_global_id(0)];
+    for (uint i = 0; i < iterations; ++i) v = intel_sub_group_shuffle(v, next) + 0.001f;
+    out[get_global_id(0)] = v;
+}
+
+SG_ATTR __kernel void local_shuffle(__global const float* in, __global float* out, const uint iterations) {
+    __local float slots[WG];
+    uint lid = get_local_id(0);
+    uint n = get_sub_group_size();
+    uint lane = get_sub_group_local_id();
+    uint source = lid - lane + (lane + 1) % n;
+    float v = in[get_global_id(0)];
+    for (uint i = 0; i < iterations; ++i) {
+        slots[lid] = v;
+        barrier(CLK_LOCAL_MEM_FENCE);
+        v = slots[source] + 0.001f;
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+    out[get_global_id(0)] = v;
+}
+
+// Block reads versus ordinary per-lane loads of the same addresses. `in` holds
+// iterations * global_size floats; each pass reads one contiguous subgroup-sized block.
+SG_ATTR __kernel void sg_block_read(__global const float* in, __global float* out, const uint iterations) {
+    uint n = get_sub_group_size();
+    uint block = get_group_id(0) * get_local_size(0) + get_sub_group_id() * n;
+    uint stride = get_global_size(0);
+    float v = 0.0f;
+    for (uint i = 0; i < iterations; ++i) {
+        v += as_float(intel_sub_group_block_read((const __global uint*)(in + i * stride + block)));
+    }
+    out[get_global_id(0)] = v;
+}
+
+SG_ATTR __kernel void plain_block_read(__global const float* in, __global float* out, const uint iterations) {
+    uint n = get_sub_group_size();
+    uint block = get_group_id(0) * get_local_size(0) + get_sub_group_id() * n;
+    uint lane = get_sub_group_local_id();
+    uint stride = get_global_size(0);
+    float v = 0.0f;
+    for (uint i = 0; i < iterations; ++i) v += in[i * stride + block + lane];
+    out[get_global_id(0)] = v;
+}
+#endif
+)";
+
+// Image and sampler kernels. Coordinates are normalised and offset by a fraction of a texel so
+// linear filtering really blends neighbours. The buffer kernels do the same work with plain
+// loads (and manual bilinear interpolation) to compare the sampler path against buffers.
+const char* imageKernelSource = R"(
+__kernel void image2d_sample(__read_only image2d_t src, __write_only image2d_t dst, sampler_t sampler) {
+    int x = get_global_id(0);
+    int y = get_global_id(1);
+    float2 size = (float2)(get_image_width(dst), get_image_height(dst));
+    float2 coord = ((float2)(x, y) + 0.25f) / size;
+    float4 v = read_imagef(src, sampler, coord);
+    write_imagef(dst, (int2)(x, y), v * 0.5f + 0.25f);
+}
+
+// 3D writes need cl_khr_3d_image_writes, so the 3D path samples into a buffer instead.
+__kernel void image3d_sample(__read_only image3d_t src, __global float4* dst, sampler_t sampler) {
+    int x = get_global_id(0);
+    int y = get_global_id(1);
+    int z = get_global_id(2);
+    int w = get_image_width(src);
+    int h = get_image_height(src);
+    float4 size = (float4)(w, h, get_image_depth(src), 1.0f);
+    float4 coord = ((float4)(x, y, z, 0.0f) + 0.25f) / size;
+    float4 v = read_imagef(src, sampler, coord);
+    dst[(z * h + y) * w + x] = v * 0.5f + 0.25f;
+}
+
+__kernel void buffer2d_nearest(__global const float4* src, __global float4* dst, const int width) {
+    int x = get_global_id(0);
+    int y = get_global_id(1);
+    dst[y * width + x] = src[y * width + x] * 0.5f + 0.25f;
+}
+
+__kernel void buffer2d_linear(__global const float4* src, __global float4* dst, const int width, const int height) {
+    int x = get_global_id(0);
+    int y = get_global_id(1);
+    int x1 = min(x + 1, width - 1);
+    int y1 = min(y + 1, height - 1);
+    float4 top = mix(src[y * width + x], src[y * width + x1], 0.25f);
+    float4 bottom = mix(src[y1 * width + x], src[y1 * width + x1], 0.25f);
+    dst[y * width + x] = mix(top, bottom, 0.25f) * 0.5f + 0.25f;
+}
+)";
+
+// Test data generator prepended to the GEMM and FFT sources: small multiples of 1/8 from a hash
+// of the element index. Must stay bit-identical to the host copy of hashed_test_value().
+const char* hashedValueKernelSource = R"(
+float hashed_test_value(uint index, uint seed) {
+    uint h = (index * 0x9E3779B1u) ^ seed;
+    h ^= h >> 15;
+    h *= 0x85EBCA6Bu;
+    h ^= h >> 13;
+    return (float)((int)(h % 17u) - 8) * 0.125f;
+}
+)";
+
+// GEMM kernels: C = A * B for square row-major n x n matrices, n a multiple of 64.
+// Matrix entries come from hashed_test_value() (hashedValueKernelSource is prepended), so
+// every product and partial sum is exact in FP32 and results can be checked on the host
+// without staging the inputs. B for the XMX path is stored in VNNI order: pairs of
+// consecutive k for the same column share one 32-bit word.
+const char* gemmKernelSource = R"(
+__kernel void gemm_init_f32(__global float* m, const uint seed) {
+    uint i = get_global_id(0);
+    m[i] = hashed_test_value(i, seed);
+}
+
+__kernel void gemm_init_f16(__global half* m, const uint seed) {
+    uint i = get_global_id(0);
+    vstore_half(hashed_test_value(i, seed), i, m);
+}
+
+__kernel void gemm_init_f16_vnni(__global half* m, const uint seed, const uint n) {
+    uint i = get_global_id(0);
+    uint pair_row = i / (2 * n);
+    uint col = (i % (2 * n)) / 2;
+    uint k = 2 * pair_row + (i & 1);
+    vstore_half(hashed_test_value(k * n + col, seed), i, m);
+}
+
+__kernel void gemm_tiled_f32(__global const float* A, __global const float* B, __global float* C, const uint n) {
+    __local float As[TILE][TILE];
+    __local float Bs[TILE][TILE];
+    uint col = get_global_id(0);
+    uint row = get_global_id(1);
+    uint lx = get_local_id(0);
+    uint ly = get_local_id(1);
+    float acc = 0.0f;
+    for (uint t = 0; t < n; t += TILE) {
+        As[ly][lx] = A[row * n + t + lx];
+        Bs[ly][lx] = B[(t + ly) * n + col];
+        barrier(CLK_LOCAL_MEM_FENCE);
+        for (uint k = 0; k < TILE; ++k) acc = fma(As[ly][k], Bs[k][lx], acc);
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+    C[row * n + col] = acc;
+}
+
+#ifdef HAS_FP16
+#pragma OPENCL EXTENSION cl_khr_fp16 : enable
+// Half storage and half multiplies with FP32 accumulation, as mixed-precision ML kernels do.
+__kernel void gemm_tiled_f16(__global const half* A, __global const half* B, __global float* C, const uint n) {
+    __local half As[TILE][TILE];
+    __local half Bs[TILE][TILE];
+    uint col = get_global_id(0);
+    uint row = get_global_id(1);
+    uint lx = get_local_id(0);
+    uint ly = get_local_id(1);
+    float acc = 0.0f;
+    for (uint t = 0; t < n; t += TILE) {
+        As[ly][lx] = A[row * n + t + lx];
+        Bs[ly][lx] = B[(t + ly) * n + col];
+        barrier(CLK_LOCAL_MEM_FENCE);
+        for (uint k = 0; k < TILE; ++k) acc += (float)(As[ly][k] * Bs[k][lx]);
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+    C[row * n + col] = acc;
+}
+#endif
+
+#ifdef HAS_XMX
+// One subgroup of 8 computes an 8x8 block of C: lane = column, the float8 holds the 8 rows.
+// Each step feeds a 8x16 slice of A (two halves per lane per row) and a 16x8 VNNI slice of B.
+#define A_ROW(m) as_int(A[((row0 + m) * n + k0) / 2 + lane])
+#define B_PAIR(j) as_int(B[(k0 / 2 + j) * n + col])
+__attribute__((intel_reqd_sub_group_size(8)))
+__kernel void gemm_xmx_f16(__global const uint* A, __global const uint* B, __global float* C, const uint n) {
+    uint col = get_global_id(0);
+    uint row0 = get_global_id(1) * 8;
+    uint lane = get_sub_group_local_id();
+    float8 acc = 0.0f;
+    for (uint k0 = 0; k0 < n; k0 += 16) {
+        int8 a = (int8)(A_ROW(0), A_ROW(1), A_ROW(2), A_ROW(3), A_ROW(4), A_ROW(5), A_ROW(6), A_ROW(7));
+        int8 b = (int8)(B_PAIR(0), B_PAIR(1), B_PAIR(2), B_PAIR(3), B_PAIR(4), B_PAIR(5), B_PAIR(6), B_PAIR(7));
+        acc = intel_sub_group_f16_f16_matrix_mad_k16(a, b, acc);
+    }
+    C[(row0 + 0) * n + col] = acc.s0;
+    C[(row0 + 1) * n + col] = acc.s1;
+    C[(row0 + 2) * n + col] = acc.s2;
+    C[(row0 + 3) * n + col] = acc.s3;
+    C[(row0 + 4) * n + col] = acc.s4;
+    C[(row0 + 5) * n + col] = acc.s5;
+    C[(row0 + 6) * n + col] = acc.s6;
+    C[(row0 + 7) * n + col] = acc.s7;
+}
+#endif
+)";
+
+// Batched complex FFT as a sequence of out-of-place Stockham stages (no bit reversal pass).
+// Each work-item performs one radix-R butterfly of one transform; `ns` is the product of the
+// radices already applied. Dimension 1 of the NDRange selects the transform in the batch.
+const char* fftKernelSource = R"(
+__kernel void fft_init(__global float2* data, const uint seed) {
+    uint i = get_global_id(0);
+    data[i] = (float2)(hashed_test_value(2 * i, seed), hashed_test_value(2 * i + 1, seed));
+}
+
+float2 mul_minus_i(float2 a) { return (float2)(a.y, -a.x); }
+
+void dft2(float2* v) {
+    float2 a = v[0];
+    v[0] = a + v[1];
+    v[1] = a - v[1];
+}
+
+void dft4(float2* v) {
+    float2 s02 = v[0] + v[2], d02 = v[0] - v[2];
+    float2 s13 = v[1] + v[3], d13 = mul_minus_i(v[1] - v[3]);
+    v[0] = s02 + s13;
+    v[1] = d02 + d13;
+    v[2] = s02 - s13;
+    v[3] = d02 - d13;
+}
+
+void dft8(float2* v) {
+    // Two radix-4 DFTs over the even and odd samples, combined with the W8^k twiddles
+    const float c = 0.70710678118654752f;
+    float2 e[4] = {v[0], v[2], v[4], v[6]};
+    float2 o[4] = {v[1], v[3], v[5], v[7]};
+    dft4(e);
+    dft4(o);
+    float2 t1 = (float2)(c * (o[1].x + o[1].y), c * (o[1].y - o[1].x));
+    float2 t2 = mul_minus_i(o[2]);
+    float2 t3 = (float2)(c * (o[3].y - o[3].x), -c * (o[3].x + o[3].y));
+    v[0] = e[0] + o[0];
+    v[4] = e[0] - o[0];
+    v[1] = e[1] + t1;
+    v[5] = e[1] - t1;
+    v[2] = e[2] + t2;
+    v[6] = e[2] - t2;
+    v[3] = e[3] + t3;
+    v[7] = e[3] - t3;
+}
+
+#define FFT_STAGE_KERNEL(R)                                                                   \
+__kernel void fft_radix##R(__global const float2* in, __global float2* out,                   \
+                           const uint n, const uint ns) {                                     \
+    uint j = get_global_id(0);                                                                \
+    uint base = get_global_id(1) * n;                                                         \
+    uint stride = n / R;                                                                      \
+    float angle = -2.0f * M_PI_F * (float)(j % ns) / (float)(ns * R);                         \
+    float2 v[R];                                                                              \
+    for (uint r = 0; r < R; ++r) {                                                            \
+        float2 x = in[base + j + r * stride];                                                 \
+        float cos_value;                                                                      \
+        float sin_value = sincos(angle * r, &cos_value);                                      \
+        v[r] = (float2)(x.x * cos_value - x.y * sin_value, x.x * sin_value + x.y * cos_value);\
+    }                                                                                         \
+    dft##R(v);                                                                                \
+    uint out_index = base + (j / ns) * ns * R + (j % ns);                                     \
+    for (uint r = 0; r < R; ++r) out[out_index + r * ns] = v[r];                              \
+}
+
+FFT_STAGE_KERNEL(2)
+FFT_STAGE_KERNEL(4)
+FFT_STAGE_KERNEL(8)
+)";
+
+// Irregular kernels over a CSR graph/matrix: row_ptr has rows + 1 entries, cols/values one per
+// nonzero. The scalar SpMV gives each row one work-item; the vector SpMV gives each row
+// ROW_LANES work-items and reduces their partial sums in local memory.
+const char* sparseKernelSource = R"(
+__kernel void spmv_csr_scalar(__global const uint* row_ptr, __global const uint* cols, __global const float* values,
+                              __global const float* x, __global float* y, const uint rows) {
+    uint row = get_global_id(0);
+    if (row >= rows) return;
+    float sum = 0.0f;
+    for (uint e = row_ptr[row]; e < row_ptr[row + 1]; ++e) sum = fma(values[e], x[cols[e]], sum);
+    y[row] = sum;
+}
+
+__kernel void spmv_csr_vector(__global const uint* row_ptr, __global const uint* cols, __global const float* values,
+                              __global const float* x, __global float* y, const uint rows) {
+    __local float partial[WG];
+    uint lid = get_local_id(0);
+    uint lane = lid % ROW_LANES;
+    uint row = get_global_id(0) / ROW_LANES;
+    float sum = 0.0f;
+    if (row < rows) {
+        for (uint e = row_ptr[row] + lane; e < row_ptr[row + 1]; e += ROW_LANES) sum = fma(values[e], x[cols[e]], sum);
+    }
+    partial[lid] = sum;
+    barrier(CLK_LOCAL_MEM_FENCE);
+    for (uint offset = ROW_LANES / 2; offset > 0; offset /= 2) {
+        if (lane < offset) partial[lid] += partial[lid + offset];
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+    if (lane == 0 && row < rows) y[row] = partial[lid];
+}
+
+// One work-item per frontier vertex; the compare-and-swap on the level claims each newly
+// reached vertex exactly once, so the next frontier has no duplicates.
+__kernel void bfs_expand(__global const uint* row_ptr, __global const uint* cols, __global int* levels,
+                         __global const uint* frontier, const uint frontier_size,
+                         __global uint* next_frontier, __global uint* next_size, const int level) {
+    uint i = get_global_id(0);
+    if (i >= frontier_size) return;
+    uint v = frontier[i];
+    for (uint e = row_ptr[v]; e < row_ptr[v + 1]; ++e) {
+        uint u = cols[e];
+        if (levels[u] == -1 && atomic_cmpxchg(&levels[u], -1, level + 1) == -1) {
+            next_frontier[atomic_inc(next_size)] = u;
+        }
+    }
+}
+)";
+
+// LSD radix sort, RADIX_BITS per pass. Each work-item owns a contiguous chunk of ITEMS keys
+// and keeps private digit counts; counts are laid out digit-major (counts[d * threads + t]) so
+// one exclusive scan over them yields every chunk's output offset per digit, and walking the
+// chunk in order keeps each pass stable. KEY_T is uint or ulong.
+const char* radixSortKernelSource = R"(
+#define RADIX (1u << RADIX_BITS)
+
+__kernel void radix_init(__global KEY_T* keys, const uint n, const uint seed) {
+    uint i = get_global_id(0);
+    if (i >= n) return;
+    uint h = (i * 0x9E3779B1u) ^ seed;
+    h ^= h >> 16; h *= 0x85EBCA6Bu; h ^= h >> 13; h *= 0xC2B2AE35u; h ^= h >> 16;
+    uint g = h * 0x27D4EB2Fu + i;
+    g ^= g >> 15; g *= 0x165667B1u; g ^= g >> 13;
+    // 32-bit keys are h alone; OR-ing in g would set each bit with probability 3/4.
+    keys[i] = sizeof(KEY_T) == 4 ? (KEY_T)h : (KEY_T)(((ulong)g << 32) | h);
+}
+
+__kernel void radix_histogram(__global const KEY_T* keys, __global uint* counts,
+                              const uint n, const uint shift, const uint threads) {
+    uint t = get_global_id(0);
+    if (t >= threads) return;
+    uint c[RADIX];
+    for (uint d = 0; d < RADIX; ++d) c[d] = 0;
+    uint end = min((t + 1) * ITEMS, n);
+    for (uint i = t * ITEMS; i < end; ++i) c[(uint)(keys[i] >> shift) & (RADIX - 1)]++;
+    for (uint d = 0; d < RADIX; ++d) counts[d * threads + t] = c[d];
+}
+
+__kernel void radix_scatter(__global const KEY_T* in, __global KEY_T* out, __global const uint* offsets,
+                            const uint n, const uint shift, const uint threads) {
+    uint t = get_global_id(0);
+    if (t >= threads) return;
+    uint o[RADIX];
+    for (uint d = 0; d < RADIX; ++d) o[d] = offsets[d * threads + t];
+    uint end = min((t + 1) * ITEMS, n);
+    for (uint i = t * ITEMS; i < end; ++i) {
+        KEY_T key = in[i];
+        out[o[(uint)(key >> shift) & (RADIX - 1)]++] = key;
+    }
+}
+
+// Work-group exclusive scan; block totals go to block_sums for the next level up.
+__kernel void scan_block(__global uint* data, __global uint* block_sums, const uint n) {
+    __local uint temp[WG];
+    uint gid = get_global_id(0);
+    uint lid = get_local_id(0);
+    uint v = gid < n ? data[gid] : 0;
+    temp[lid] = v;
+    barrier(CLK_LOCAL_MEM_FENCE);
+    for (uint offset = 1; offset < WG; offset *= 2) {
+        uint add = lid >= offset ? temp[lid - offset] : 0;
+        barrier(CLK_LOCAL_MEM_FENCE);
+        temp[lid] += add;
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+    if (gid < n) data[gid] = temp[lid] - v;
+    if (lid == WG - 1) block_sums[get_group_id(0)] = temp[lid];
+}
+
+__kernel void scan_add(__global uint* data, __global const uint* block_offsets, const uint n) {
+    uint gid = get_global_id(0);
+    if (gid < n) data[gid] += block_offsets[get_group_id(0)];
+}
+
+__kernel void radix_check_sorted(__global const KEY_T* keys, const uint n, __global uint* errors) {
+    uint i = get_global_id(0);
+    if (i + 1 < n && keys[i] > keys[i + 1]) atomic_inc(errors);
+}
+)";
+
+// Integer hashing kernels: each work-item hashes one MESSAGE_WORDS * 4 byte message, whose
+// bytes are the buffer's little-endian words. MESSAGE_WORDS is a multiple of 16, so messages
+// are whole SHA-256 blocks and whole xxHash32 stripes.
+const char* hashKernelSource = R"(
+uint test_word(uint i) {
+    i ^= i >> 16; i *= 0x7FEB352Du; i ^= i >> 15; i *= 0x846CA68Bu; i ^= i >> 16;
+    return i;
+}
+
+__kernel void hash_init(__global uint* data) {
+    uint i = get_global_id(0);
+    data[i] = test_word(i);
+}
+
+// rotate() in OpenCL C rotates left
+#define ROTR(x, n) rotate((x), (uint)(32 - (n)))
+#define CH(x, y, z) bitselect((z), (y), (x))
+#define MAJ(x, y, z) bitselect((x), (y), (z) ^ (x))
+#define BSWAP(x) (rotate((x) & 0x00FF00FFu, 24u) | rotate((x) & 0xFF00FF00u, 8u))
+
+__constant uint sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+void sha256_block(uint* state, uint* w) {
+    for (uint t = 16; t < 64; ++t) {
+        uint s0 = ROTR(w[t - 15], 7) ^ ROTR(w[t - 15], 18) ^ (w[t - 15] >> 3);
+        uint s1 = ROTR(w[t - 2], 17) ^ ROTR(w[t - 2], 19) ^ (w[t - 2] >> 10);
+        w[t] = w[t - 16] + s0 + w[t - 7] + s1;
+    }
+    uint a = state[0], b = state[1], c = state[2], d = state[3];
+    uint e = state[4], f = state[5], g = state[6], h = state[7];
+    for (uint t = 0; t < 64; ++t) {
+        uint t1 = h + (ROTR(e, 6) ^ ROTR(e, 11) ^ ROTR(e, 25)) + CH(e, f, g) + sha256_k[t] + w[t];
+        uint t2 = (ROTR(a, 2) ^ ROTR(a, 13) ^ ROTR(a, 22)) + MAJ(a, b, c);
+        h = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+    state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+    state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+__kernel void sha256_messages(__global const uint* data, __global uint* digests) {
+    uint id = get_global_id(0);
+    __global const uint* message = data + (size_t)id * MESSAGE_WORDS;
+    uint state[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+    uint w[64];
+    for (uint block = 0; block < MESSAGE_WORDS; block += 16) {
+        for (uint t = 0; t < 16; ++t) w[t] = BSWAP(message[block + t]);
+        sha256_block(state, w);
+    }
+    // Padding block: 0x80 terminator, zeros, 64-bit big-endian bit length
+    for (uint t = 0; t < 16; ++t) w[t] = 0;
+    w[0] = 0x80000000u;
+    w[15] = MESSAGE_WORDS * 32;
+    sha256_block(state, w);
+    for (uint i = 0; i < 8; ++i) digests[(size_t)id * 8 + i] = state[i];
+}
+
+#define XXH_PRIME1 0x9E3779B1u
+#define XXH_PRIME2 0x85EBCA77u
+#define XXH_PRIME3 0xC2B2AE3Du
+#define XXH_PRIME4 0x27D4EB2Fu
+#define XXH_PRIME5 0x165667B1u
+#define XXH_ROUND(acc, input) (rotate((acc) + (input) * XXH_PRIME2, 13u) * XXH_PRIME1)
+
+__kernel void xxh32_messages(__global const uint* data, __global uint* digests, const uint seed) {
+    uint id = get_global_id(0);
+    __global const uint4* message = (__global const uint4*)(data + (size_t)id * MESSAGE_WORDS);
+    uint v1 = seed + XXH_PRIME1 + XXH_PRIME2;
+    uint v2 = seed + XXH_PRIME2;
+    uint v3 = seed;
+    uint v4 = seed - XXH_PRIME1;
+    for (uint stripe = 0; stripe < MESSAGE_WORDS / 4; ++stripe) {
+        uint4 in = message[stripe];
+        v1 = XXH_ROUND(v1, in.x);
+        v2 = XXH_ROUND(v2, in.y);
+        v3 = XXH_ROUND(v3, in.z);
+        v4 = XXH_ROUND(v4, in.w);
+    }
+    uint h = rotate(v1, 1u) + rotate(v2, 7u) + rotate(v3, 12u) + rotate(v4, 18u);
+    h += MESSAGE_WORDS * 4;
+    h ^= h >> 15; h *= XXH_PRIME2;
+    h ^= h >> 13; h *= XXH_PRIME3;
+    h ^= h >> 16;
+    digests[id] = h;
+}
+)";
+
+// Branch divergence kernel. Work-items are grouped into units of `granularity` consecutive ids
+// (1 = per lane, subgroup-sized, or the work-group size) and a hash of the unit decides
+// whether it takes path A or path B; `threshold` out of 1024 units take path A. The two paths
+// use different operations so the compiler cannot merge them into one predicated loop.
+const char* divergenceKernelSource = R"(
+#ifdef SG_SIZE
+#define SG_ATTR __attribute__((intel_reqd_sub_group_size(SG_SIZE)))
+#else
+#define SG_ATTR
+#endif
+
+SG_ATTR __kernel void divergence(__global float* out, const uint granularity, const uint threshold, const uint iterations) {
+    uint gid = get_global_id(0);
+    uint unit = gid / granularity;
+    unit ^= unit >> 16; unit *= 0x7FEB352Du; unit ^= unit >> 15; unit *= 0x846CA68Bu; unit ^= unit >> 16;
+    float v = (float)(gid & 1023) * 0.001f;
+    if ((unit & 1023) < threshold) {
+        for (uint i = 0; i < iterations; ++i) v = fma(v, v, 0.25f) * 0.5f;
+    } else {
+        for (uint i = 0; i < iterations; ++i) v = native_sqrt(v + 0.5f) * 0.75f;
+    }
+    out[gid] = v;
+}
+)";
+
+// Roofline kernel: each work-item streams one float4 in and one out (32 bytes) and applies
+// FMAS dependent fused multiply-adds per component (8 * FMAS flops), so FMAS / 4 is the
+// arithmetic intensity in flops per byte. The multiplier and addend are kernel arguments so
+// the chain cannot be folded at compile time.
+const char* rooflineKernelSource = R"(
+__kernel void roofline(__global const float4* in, __global float4* out, const float a, const float b) {
+    uint id = get_global_id(0);
+    float4 v = in[id];
+    #pragma unroll 16
+    for (int i = 0; i < FMAS; ++i) v = fma(v, a, b);
+    out[id] = v;
+}
+)";
+
+// OpenCL 2.0 pipe producer/consumer pair. Packets are PACKET_WORDS uints; word 0 carries a
+// sequence number so the consumer can checksum what arrived. A full (or empty) pipe is retried
+// up to MAX_SPINS times, so a runtime that does not run both kernels concurrently reports
+// stalls instead of hanging.
+const char* pipeKernelSource = R"(
+typedef struct { uint words[PACKET_WORDS]; } packet_t;
+
+#define MAX_SPINS (1u << 20)
+
+__kernel void pipe_producer(__write_only pipe packet_t out_pipe, const uint packets_per_item, __global uint* stalls) {
+    uint id = get_global_id(0);
+    packet_t packet;
+    for (uint w = 1; w < PACKET_WORDS; ++w) packet.words[w] = id ^ w;
+    for (uint p = 0; p < packets_per_item; ++p) {
+        packet.words[0] = id * packets_per_item + p;
+        uint spins = 0;
+        while (write_pipe(out_pipe, &packet) != 0) {
+            if (++spins == MAX_SPINS) {
+                atomic_inc(stalls);
+                break;
+            }
+        }
+    }
+}
+
+__kernel void pipe_consumer(__read_only pipe packet_t in_pipe, const uint packets_per_item,
+                            __global uint* checksum, __global uint* stalls) {
+    packet_t packet;
+    uint sum = 0;
+    for (uint p = 0; p < packets_per_item; ++p) {
+        uint spins = 0;
+        while (read_pipe(in_pipe, &packet) != 0) {
+            if (++spins == MAX_SPINS) {
+                atomic_inc(stalls);
+                break;
+            }
+        }
+        if (spins < MAX_SPINS) sum += packet.words[0];
+    }
+    atomic_add(checksum, sum);
+}
+)";
+
+// VRAM integrity test. Patterns are a pure function of (word address, kind, seed) so the
+// check kernel regenerates them instead of reading a reference copy: walking ones/zeros and
+// Philox4x32-10 noise. memtest_check optionally writes back the inverse of what it expected,
+// which gives memtest86-style moving inversions in one read+write pass.
+const char* memtestKernelSource = R"(
+#define WALK_ONES 0
+#define WALK_ZEROS 1
+#define PHILOX 2
+
+uint4 philox4x32_10(uint4 ctr, uint2 key) {
+    for (int round = 0; round < 10; ++round) {
+        uint hi0 = mul_hi(0xD2511F53u, ctr.x), lo0 = 0xD2511F53u * ctr.x;
+        uint hi1 = mul_hi(0xCD9E8D57u, ctr.z), lo1 = 0xCD9E8D57u * ctr.z;
+        ctr = (uint4)(hi1 ^ ctr.y ^ key.x, lo1, hi0 ^ ctr.w ^ key.y, lo0);
+        key += (uint2)(0x9E3779B9u, 0xBB67AE85u);
+    }
+    return ctr;
+}
+
+uint4 pattern(ulong vec, uint kind, uint seed) {
+    if (kind == PHILOX) return philox4x32_10((uint4)((uint)vec, (uint)(vec >> 32), seed, 0), (uint2)(seed, 0x6D656D74u));
+    uint4 shift = ((uint4)((uint)vec * 4u + seed) + (uint4)(0, 1, 2, 3)) & 31u;
+    uint4 walk = (uint4)(1u) << shift;
+    return kind == WALK_ZEROS ? ~walk : walk;
+}
+
+__kernel void memtest_fill(__global uint4* buf, const ulong base_vec, const uint kind, const uint seed) {
+    size_t i = get_global_id(0);
+    buf[i] = pattern(base_vec + i, kind, seed);
+}
+
+void log_error(ulong word, uint expected, uint actual, __global uint* error_count, __global uint4* error_log) {
+    uint slot = atomic_inc(error_count);
+    if (slot < MAX_LOGGED) error_log[slot] = (uint4)((uint)word, (uint)(word >> 32), expected, actual);
+}
+
+__kernel void memtest_check(__global uint4* buf, const ulong base_vec, const uint kind, const uint seed,
+                            const uint inverted, const uint write_inverse,
+                            __global uint* error_count, __global uint4* error_log) {
+    size_t i = get_global_id(0);
+    uint4 expected = pattern(base_vec + i, kind, seed);
+    if (inverted) expected = ~expected;
+    uint4 actual = buf[i];
+    if (any(actual != expected)) {
+        ulong word = (base_vec + i) * 4;
+        if (actual.x != expected.x) log_error(word + 0, expected.x, actual.x, error_count, error_log);
+        if (actual.y != expected.y) log_error(word + 1, expected.y, actual.y, error_count, error_log);
+        if (actual.z != expected.z) log_error(word + 2, expected.z, actual.z, error_count, error_log);
+        if (actual.w != expected.w) log_error(word + 3, expected.w, actual.w, error_count, error_log);
+    }
+    if (write_inverse) buf[i] = ~expected;
+}
+)";
+
+// Oversubscription probe: one cheap read-modify-write pass over a buffer, so the time per
+// access is dominated by whether the buffer is resident.
+const char* oversubKernelSource = R"(
+__kernel void oversub_touch(__global float4* data) {
+    size_t i = get_global_id(0);
+    data[i] = data[i] * 0.999f + 1.0f;
+}
+)";
+
+// Collectives over host staging. Ranks start from small integer data so every sum is exact
+// in float and the host can check results element for element.
+const char* collectiveKernelSource = R"(
+__kernel void collective_init(__global float* data, const uint rank) {
+    uint i = get_global_id(0);
+    data[i] = (float)((i + 3 * rank) % 17);
+}
+
+__kernel void collective_add(__global float* data, __global const float* recv, const uint offset) {
+    uint i = offset + get_global_id(0);
+    data[i] += recv[i];
+}
+)";
+
+// Stream mode producer: a cheap integer mix per element, so the device side of the pipeline
+// runs well ahead of readback and storage.
+const char* streamKernelSource = R"(
+__kernel void stream_produce(__global uint4* out, const uint sequence) {
+    uint i = get_global_id(0);
+    uint x = (i ^ (sequence * 0x9E3779B9u)) * 0x85EBCA6Bu;
+    x ^= x >> 13;
+    out[i] = (uint4)(sequence, i, x, x * 0xC2B2AE35u);
+}
+)";
+
+// Cross-ICD launch overhead probe.
+const char* emptyKernelSource = R"(
+__kernel void empty_kernel(__global uint* sink) {
+    if (get_global_id(0) == 0xFFFFFFFFu) sink[0] = 1;
+}
 )";
 
-void check_cl_error(cl_int err, const char* operation) {
-    if (err != CL_SUCCESS) {
-        throw std::runtime_error(std::string(operation) + " failed with error code " + std::to_string(err));
+#ifndef CL_DEVICE_SUB_GROUP_SIZES_INTEL
+#define CL_DEVICE_SUB_GROUP_SIZES_INTEL 0x4108 // cl_intel_required_subgroup_size
+#endif
+#ifndef CL_DEVICE_PCI_BUS_INFO_KHR
+#define CL_DEVICE_PCI_BUS_INFO_KHR 0x410F // cl_khr_pci_bus_info
+#endif
+#ifndef CL_DEVICE_PIPE_SUPPORT
+#define CL_DEVICE_PIPE_SUPPORT 0x1071 // OpenCL 3.0: pipes became optional
+#endif
+#ifndef CL_DEVICE_SINGLE_FP_ATOMIC_CAPABILITIES_EXT
+#define CL_DEVICE_SINGLE_FP_ATOMIC_CAPABILITIES_EXT 0x4231 // cl_ext_float_atomics
+#define CL_DEVICE_GLOBAL_FP_ATOMIC_ADD_EXT (1 << 1)
+#define CL_DEVICE_LOCAL_FP_ATOMIC_ADD_EXT (1 << 17)
+#endif
+#ifndef CL_KERNEL_SPILL_MEM_SIZE_INTEL
+#define CL_KERNEL_SPILL_MEM_SIZE_INTEL 0x4109 // cl_intel_required_subgroup_size
+#endif
+
+// Command line settings shared by every mode. Defaults keep the original behaviour:
+// running the binary without arguments starts the continuous load on every Intel GPU.
+struct Options {
+    std::string mode = "load";
+    size_t size_mb = 64;    // Buffer footprint used by the benchmark modes
+    int repeat = 10;        // Timed kernel launches averaged per measurement
+    size_t fft_size = 4096; // Points per transform (power of two)
+    size_t fft_batch = 0;   // Transforms per launch; 0 fills --size-mb
+    std::string output;     // Data file for modes that export results (.json or .csv)
+    size_t packet_bytes = 0; // Pipe packet size; 0 sweeps a default set
+    size_t pipe_depth = 0;   // Pipe capacity in packets; 0 sweeps a default set
+    size_t duration_s = 0;   // Wall-clock limit for the continuous modes; 0 runs until interrupted
+    size_t iterations = 0;   // Per-device iteration limit for the continuous modes; 0 is unlimited
+    bool host_init = false;  // Stage the load buffer through host memory (the old path), for comparison
+    size_t working_set_pct = 0; // Oversubscription working set in % of global memory; 0 sweeps a default set
+    size_t divergence_pct = 0;  // Share of divergence units on path A in %; 0 sweeps a default set
+    size_t divergence_granularity = 0; // Consecutive work-items per divergence unit; 0 sweeps a default set
+    bool huge_pages = false;    // Back the pinned host pool with 2 MB pages
+    std::string stream_dir;     // Target directory for the stream mode
+    bool direct_io = false;     // Open stream files with O_DIRECT
+    bool stream_drop = false;   // Stream mode drops chunks when storage is behind instead of stalling the device
+    size_t contexts = 4;        // Competing contexts in the fairness mode
+    bool processes = false;     // Fairness contexts live in separate processes instead of threads
+    int device = -1;            // Run only on this device index; -1 runs on all
+    bool all_platforms = false; // icd mode: compare every GPU on every platform, not just Intel devices
+};
+
+Options g_options;
+std::mutex g_output_mutex; // Keeps per-device benchmark reports from interleaving
+std::atomic<bool> g_stop_requested{false}; // Set by SIGINT/SIGTERM; continuous loops finish their iteration and exit
+
+extern "C" void handle_stop_signal(int signal_number) {
+    g_stop_requested = true;
+    std::signal(signal_number, SIG_DFL); // A second Ctrl-C kills the process outright
+}
+
+void check_cl_error(cl_int err, const char* operation) {
+    if (err != CL_SUCCESS) {
+        throw std::runtime_error(std::string(operation) + " failed with error code " + std::to_string(err));
+    }
+}
+
+std::string get_device_name(cl_device_id device) {
+    char deviceName[128];
+    clGetDeviceInfo(device, CL_DEVICE_NAME, sizeof(deviceName), deviceName, NULL);
+    return deviceName;
+}
+
+std::string get_device_string(cl_device_id device, cl_device_info param) {
+    size_t size = 0;
+    clGetDeviceInfo(device, param, 0, nullptr, &size);
+    std::string value(size, '\0');
+    clGetDeviceInfo(device, param, size, &value[0], nullptr);
+    if (!value.empty() && value.back() == '\0') value.pop_back();
+    return value;
+}
+
+bool device_has_extension(cl_device_id device, const std::string& extension) {
+    std::string extensions = " " + get_device_string(device, CL_DEVICE_EXTENSIONS) + " ";
+    return extensions.find(" " + extension + " ") != std::string::npos;
+}
+
+// Returns the device OpenCL version as major * 10 + minor, e.g. 30 for "OpenCL 3.0 NEO".
+int device_cl_version(cl_device_id device) {
+    std::string version = get_device_string(device, CL_DEVICE_VERSION);
+    int major = 1, minor = 2;
+    std::sscanf(version.c_str(), "OpenCL %d.%d", &major, &minor);
+    return major * 10 + minor;
+}
+
+// Every SIMD width the compiler can be forced to through cl_intel_required_subgroup_size, or
+// a single 0 ("compiler's choice") when the device cannot pin it.
+std::vector<size_t> forceable_subgroup_sizes(cl_device_id device) {
+    std::vector<size_t> sizes;
+    if (device_has_extension(device, "cl_intel_required_subgroup_size")) {
+        size_t size = 0;
+        if (clGetDeviceInfo(device, CL_DEVICE_SUB_GROUP_SIZES_INTEL, 0, nullptr, &size) == CL_SUCCESS && size > 0) {
+            sizes.resize(size / sizeof(size_t));
+            clGetDeviceInfo(device, CL_DEVICE_SUB_GROUP_SIZES_INTEL, size, sizes.data(), nullptr);
+        }
+    }
+    if (sizes.empty()) sizes.push_back(0);
+    return sizes;
+}
+
+// Newest -cl-std the device accepts among the ones our kernels are written against.
+std::string cl_std_option(cl_device_id device) {
+    int version = device_cl_version(device);
+    if (version >= 30) return "-cl-std=CL3.0";
+    if (version >= 20) return "-cl-std=CL2.0";
+    return "-cl-std=CL1.2";
+}
+
+cl_context create_context(cl_platform_id platform, cl_device_id device) {
+    cl_int err;
+    cl_context_properties props[] = {CL_CONTEXT_PLATFORM, (cl_context_properties)platform, 0};
+    cl_context context = clCreateContext(props, 1, &device, nullptr, nullptr, &err);
+    check_cl_error(err, "clCreateContext");
+    return context;
+}
+
+// One context spanning several devices of a platform, for modes that share buffers between them.
+cl_context create_context(cl_platform_id platform, const std::vector<cl_device_id>& devices) {
+    cl_int err;
+    cl_context_properties props[] = {CL_CONTEXT_PLATFORM, (cl_context_properties)platform, 0};
+    cl_context context = clCreateContext(props, static_cast<cl_uint>(devices.size()), devices.data(), nullptr, nullptr, &err);
+    check_cl_error(err, "clCreateContext(shared)");
+    return context;
+}
+
+cl_command_queue create_queue(cl_context context, cl_device_id device, int device_index,
+                              cl_command_queue_properties properties = 0) {
+    cl_int err;
+    // Create a command queue. clCreateCommandQueue is deprecated in OpenCL 2.0+,
+    // but often still available. clCreateCommandQueueWithProperties is preferred.
+    cl_queue_properties queue_props[] = {CL_QUEUE_PROPERTIES, properties, 0};
+    cl_command_queue queue = clCreateCommandQueueWithProperties(context, device, properties ? queue_props : nullptr, &err);
+    if (err != CL_SUCCESS) { // Fallback for older OpenCL versions if WithProperties fails
+        std::cout << "Device " << device_index << ": clCreateCommandQueueWithProperties failed (" << err << "), trying clCreateCommandQueue." << std::endl;
+        queue = clCreateCommandQueue(context, device, properties, &err); // Deprecated in OpenCL 2.0
+    }
+    check_cl_error(err, "clCreateCommandQueue(WithProperties)");
+    return queue;
+}
+
+std::string get_build_log(cl_program program, cl_device_id device) {
+    size_t log_size = 0;
+    clGetProgramBuildInfo(program, device, CL_PROGRAM_BUILD_LOG, 0, nullptr, &log_size);
+    std::vector<char> log(log_size + 1, '\0');
+    clGetProgramBuildInfo(program, device, CL_PROGRAM_BUILD_LOG, log_size, log.data(), nullptr);
+    return log.data();
+}
+
+cl_program build_program(cl_context context, cl_device_id device, int device_index,
+                         const char* source, const std::string& options) {
+    cl_int err;
+    cl_program program = clCreateProgramWithSource(context, 1, &source, nullptr, &err);
+    check_cl_error(err, "clCreateProgramWithSource");
+
+    err = clBuildProgram(program, 1, &device, options.c_str(), nullptr, nullptr);
+    if (err != CL_SUCCESS) {
+        std::cerr << "Device " << device_index << " Kernel build log:\n" << get_build_log(program, device) << std::endl;
+        clReleaseProgram(program);
+        check_cl_error(err, "clBuildProgram");
+    }
+    return program;
+}
+
+// Launches the kernel once to warm caches and JIT state, then `repeat` more times on a
+// profiling-enabled queue. Returns the mean device execution time in milliseconds.
+double time_kernel_ms(cl_command_queue queue, cl_kernel kernel, cl_uint dims,
+                      const size_t* global_work_size, const size_t* local_work_size, int repeat) {
+    cl_int err = clEnqueueNDRangeKernel(queue, kernel, dims, nullptr, global_work_size, local_work_size, 0, nullptr, nullptr);
+    check_cl_error(err, "clEnqueueNDRangeKernel(warmup)");
+    check_cl_error(clFinish(queue), "clFinish(warmup)");
+
+    double total_ms = 0.0;
+    for (int i = 0; i < repeat; ++i) {
+        cl_event event;
+        err = clEnqueueNDRangeKernel(queue, kernel, dims, nullptr, global_work_size, local_work_size, 0, nullptr, &event);
+        check_cl_error(err, "clEnqueueNDRangeKernel");
+        check_cl_error(clWaitForEvents(1, &event), "clWaitForEvents");
+        cl_ulong start = 0, end = 0;
+        clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_START, sizeof(start), &start, nullptr);
+        clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_END, sizeof(end), &end, nullptr);
+        clReleaseEvent(event);
+        total_ms += (end - start) * 1e-6;
+    }
+    return total_ms / repeat;
+}
+
+// Bookkeeping for the continuous modes: enforces --duration/--iterations and the stop signal,
+// and collects per-iteration latency for the summary printed when the loop ends.
+struct LoopStats {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    size_t iterations = 0;
+    double total_ms = 0.0;
+    double min_ms = 0.0;
+    double max_ms = 0.0;
+
+    void record(double ms) {
+        min_ms = iterations == 0 ? ms : std::min(min_ms, ms);
+        max_ms = std::max(max_ms, ms);
+        total_ms += ms;
+        ++iterations;
+    }
+
+    bool done() const {
+        if (g_stop_requested) return true;
+        if (g_options.iterations && iterations >= g_options.iterations) return true;
+        return g_options.duration_s &&
+               std::chrono::steady_clock::now() - start >= std::chrono::seconds(g_options.duration_s);
+    }
+};
+
+// `work_per_iteration` is measured in `unit`s; throughput is reported in millions of them per second.
+void print_loop_summary(int device_index, const std::string& name, const LoopStats& stats,
+                        double work_per_iteration, const char* unit) {
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - stats.start).count();
+    std::ostringstream report;
+    report << "Device " << device_index << " (" << name << ") summary: " << stats.iterations << " iterations in "
+           << std::fixed << std::setprecision(1) << elapsed << " s";
+    if (stats.iterations) {
+        report << ", " << std::setprecision(2) << stats.iterations * work_per_iteration / (elapsed * 1e6) << " M" << unit
+               << "/s; latency ms min " << std::setprecision(3) << stats.min_ms << " / mean " << stats.total_ms / stats.iterations
+               << " / max " << stats.max_ms;
+    }
+    report << (g_stop_requested ? " (interrupted)" : "") << "\n";
+    std::lock_guard<std::mutex> lock(g_output_mutex);
+    std::cout << report.str() << std::flush;
+}
+
+// "dddd:bb:dd.f" PCI address of the device, or "" without cl_khr_pci_bus_info.
+std::string device_pci_address(cl_device_id device) {
+    struct { cl_uint domain, bus, device, function; } pci = {};
+    if (!device_has_extension(device, "cl_khr_pci_bus_info") ||
+        clGetDeviceInfo(device, CL_DEVICE_PCI_BUS_INFO_KHR, sizeof(pci), &pci, nullptr) != CL_SUCCESS) {
+        return "";
+    }
+    char address[32];
+    std::snprintf(address, sizeof(address), "%04x:%02x:%02x.%x", pci.domain, pci.bus, pci.device, pci.function);
+    return address;
+}
+
+// NUMA node of the device's PCI function from sysfs, or -1 when unknown (no cl_khr_pci_bus_info,
+// integrated GPU, or a single-node machine).
+int device_numa_node(cl_device_id device) {
+    std::string address = device_pci_address(device);
+    if (address.empty()) return -1;
+    std::ifstream file("/sys/bus/pci/devices/" + address + "/numa_node");
+    int node = -1;
+    file >> node;
+    return file ? node : -1;
+}
+
+// Pinned host staging memory shared by the transfer-heavy modes. One slab is mapped up front
+// (optionally on 2 MB pages and preferring the device's NUMA node), faulted in, and registered
+// with the driver once as a CL_MEM_USE_HOST_PTR buffer. Blocks are offsets into that buffer:
+// transfers are clEnqueueCopyBuffer calls to or from `slab`, so they DMA into already pinned
+// pages instead of pinning (or bouncing through) pageable memory on every call. A pool prefers
+// one device's NUMA node, so code staging for several devices keeps one pool per device.
+struct PinnedPool {
+    cl_mem slab = nullptr;
+    char* host = nullptr;
+    size_t bytes = 0;
+    const char* backing = "4K pages";
+    int numa_node = -1;
+    double setup_ms = 0.0;
+    std::mutex mutex;
+    std::vector<std::pair<size_t, size_t>> free_list; // (offset, bytes), sorted by offset
+};
+
+struct PinnedBlock {
+    size_t offset = 0; // Into PinnedPool::slab
+    size_t bytes = 0;  // 0 when the pool had no room
+    char* host = nullptr;
+};
+
+void create_pinned_pool(PinnedPool& pool, cl_context context, cl_device_id device, size_t bytes, bool huge_pages) {
+    auto start = std::chrono::steady_clock::now();
+    const size_t huge_page = 2 * 1024 * 1024;
+    pool.bytes = (bytes + huge_page - 1) / huge_page * huge_page;
+    void* memory = MAP_FAILED;
+    if (huge_pages) {
+        memory = mmap(nullptr, pool.bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (memory != MAP_FAILED) pool.backing = "2M hugetlb";
+    }
+    if (memory == MAP_FAILED) {
+        memory = mmap(nullptr, pool.bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED) throw std::runtime_error("mmap of the pinned host pool failed");
+        // Without reserved hugetlb pages, transparent huge pages are the next best thing.
+        if (huge_pages && madvise(memory, pool.bytes, MADV_HUGEPAGE) == 0) pool.backing = "THP";
+    }
+    pool.host = static_cast<char*>(memory);
+
+    pool.numa_node = device_numa_node(device);
+    if (pool.numa_node >= 0 && pool.numa_node < 64) {
+        const int kMpolPreferred = 1;
+        unsigned long node_mask = 1UL << pool.numa_node;
+        if (syscall(SYS_mbind, pool.host, pool.bytes, kMpolPreferred, &node_mask, sizeof(node_mask) * 8, 0) != 0) pool.numa_node = -1;
+    }
+    std::memset(pool.host, 0, pool.bytes); // Fault every page in now, on the preferred node
+
+    cl_int err;
+    pool.slab = clCreateBuffer(context, CL_MEM_READ_WRITE | CL_MEM_USE_HOST_PTR, pool.bytes, pool.host, &err);
+    check_cl_error(err, "clCreateBuffer(pinned pool)");
+    pool.free_list = {{0, pool.bytes}};
+    pool.setup_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void release_pinned_pool(PinnedPool& pool) {
+    if (pool.slab) clReleaseMemObject(pool.slab);
+    if (pool.host) munmap(pool.host, pool.bytes);
+    pool.slab = nullptr;
+    pool.host = nullptr;
+}
+
+// First fit, page aligned. Returns a block with bytes == 0 when nothing large enough is free.
+PinnedBlock acquire_pinned(PinnedPool& pool, size_t bytes) {
+    const size_t page = 4096;
+    bytes = (bytes + page - 1) / page * page;
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    for (auto it = pool.free_list.begin(); it != pool.free_list.end(); ++it) {
+        if (it->second < bytes) continue;
+        PinnedBlock block;
+        block.offset = it->first;
+        block.bytes = bytes;
+        block.host = pool.host + it->first;
+        it->first += bytes;
+        it->second -= bytes;
+        if (it->second == 0) pool.free_list.erase(it);
+        return block;
+    }
+    return PinnedBlock();
+}
+
+void release_pinned(PinnedPool& pool, const PinnedBlock& block) {
+    if (block.bytes == 0) return;
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    auto it = std::lower_bound(pool.free_list.begin(), pool.free_list.end(), std::make_pair(block.offset, size_t(0)));
+    it = pool.free_list.insert(it, {block.offset, block.bytes});
+    // Coalesce with the following and preceding free ranges
+    if (it + 1 != pool.free_list.end() && it->first + it->second == (it + 1)->first) {
+        it->second += (it + 1)->second;
+        pool.free_list.erase(it + 1);
+    }
+    if (it != pool.free_list.begin() && (it - 1)->first + (it - 1)->second == it->first) {
+        (it - 1)->second += it->second;
+        pool.free_list.erase(it);
+    }
+}
+
+// Staging bound for bulk uploads: large inputs go through a pool this size in pieces, so the
+// pinned footprint stays fixed however big the input is.
+const size_t kUploadStagingBytes = 64 * 1024 * 1024;
+
+// Uploads pageable host data into `buffer` through one pool block, a block-sized piece at a
+// time. Bulk inputs use this instead of CL_MEM_COPY_HOST_PTR, which leaves the driver to pin
+// or bounce the whole vector on its own.
+void upload_through_pinned(cl_command_queue queue, PinnedPool& pool, cl_mem buffer, const void* data, size_t bytes) {
+    PinnedBlock block = acquire_pinned(pool, std::min(bytes, pool.bytes));
+    if (block.bytes == 0) throw std::runtime_error("pinned pool exhausted");
+    cl_int err;
+    for (size_t done = 0; done < bytes; done += block.bytes) {
+        size_t piece = std::min(block.bytes, bytes - done);
+        // Blocking map: on the in-order queue it also waits for the previous piece's copy out of the block.
+        void* host = clEnqueueMapBuffer(queue, pool.slab, CL_TRUE, CL_MAP_WRITE_INVALIDATE_REGION, block.offset, piece, 0, nullptr,
+                                        nullptr, &err);
+        check_cl_error(err, "clEnqueueMapBuffer(upload)");
+        std::memcpy(host, static_cast<const char*>(data) + done, piece);
+        check_cl_error(clEnqueueUnmapMemObject(queue, pool.slab, host, 0, nullptr, nullptr), "clEnqueueUnmapMemObject(upload)");
+        check_cl_error(clEnqueueCopyBuffer(queue, pool.slab, buffer, block.offset, done, piece, 0, nullptr, nullptr),
+                       "clEnqueueCopyBuffer(upload)");
+    }
+    check_cl_error(clFinish(queue), "clFinish(upload)");
+    release_pinned(pool, block);
+}
+
+void run_load_on_device(cl_platform_id platform, cl_device_id device, int device_index) {
+    cl_int err;
+    auto startup = std::chrono::steady_clock::now();
+    std::cout << "Starting load on Device " << device_index << ": " << get_device_name(device) << std::endl;
+
+    cl_context context = create_context(platform, device);
+    cl_command_queue queue = create_queue(context, device, device_index);
+
+    // Try to build for OpenCL 1.2, which is very common.
+    // If you need features from newer versions and your hardware/driver supports it, you can change this.
+    cl_program program = build_program(context, device, device_index, kernelSource, "-cl-std=CL1.2");
+
+    cl_kernel kernel = clCreateKernel(program, "load_kernel", &err);
+    check_cl_error(err, "clCreateKernel");
+
+    // Adjust dataSize based on GPU memory and desired parallelism
+    // Larger dataSize means more work items if global_work_size is tied to it.
+    const size_t dataSizeElements = 1024 * 1024 * 8; // 8M floats -> 32MB
+    int count_arg = static_cast<int>(dataSizeElements);
+    size_t global_work_size = dataSizeElements;
+
+    // Initialize on the device by default: no host copy of the buffer, and nothing kept alive
+    // on the host for the whole run. --host-init restores the staged upload for comparison.
+    auto init_start = std::chrono::steady_clock::now();
+    cl_mem buffer;
+    if (g_options.host_init) {
+        std::vector<float> host_data(dataSizeElements);
+        for(size_t i = 0; i < dataSizeElements; ++i) host_data[i] = static_cast<float>(i % 100) + 0.1f; // Simple initial data
+        buffer = clCreateBuffer(context, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR,
+                                sizeof(float) * dataSizeElements, host_data.data(), &err);
+        check_cl_error(err, "clCreateBuffer");
+    } else {
+        buffer = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(float) * dataSizeElements, nullptr, &err);
+        check_cl_error(err, "clCreateBuffer");
+        cl_kernel init = clCreateKernel(program, "load_init", &err);
+        check_cl_error(err, "clCreateKernel(load_init)");
+        err = clSetKernelArg(init, 0, sizeof(cl_mem), &buffer);
+        check_cl_error(err, "clSetKernelArg(load_init buffer)");
+        err = clSetKernelArg(init, 1, sizeof(int), &count_arg);
+        check_cl_error(err, "clSetKernelArg(load_init count)");
+        check_cl_error(clEnqueueNDRangeKernel(queue, init, 1, nullptr, &global_work_size, nullptr, 0, nullptr, nullptr),
+                       "clEnqueueNDRangeKernel(load_init)");
+        clReleaseKernel(init);
+    }
+    check_cl_error(clFinish(queue), "clFinish(init)");
+    struct rusage usage = {};
+    getrusage(RUSAGE_SELF, &usage);
+    std::ostringstream init_report;
+    init_report << "Device " << device_index << ": buffer initialized " << (g_options.host_init ? "from host" : "on device")
+                << " in " << std::fixed << std::setprecision(1)
+                << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - init_start).count()
+                << " ms (startup " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startup).count()
+                << " ms), process peak RSS " << usage.ru_maxrss / 1024 << " MB\n";
+    {
+        std::lock_guard<std::mutex> lock(g_output_mutex);
+        std::cout << init_report.str() << std::flush;
+    }
+
+    err = clSetKernelArg(kernel, 0, sizeof(cl_mem), &buffer);
+    check_cl_error(err, "clSetKernelArg(buffer)");
+    err = clSetKernelArg(kernel, 1, sizeof(int), &count_arg);
+    check_cl_error(err, "clSetKernelArg(count)");
+
+    // Local work size can be tuned. Query CL_KERNEL_WORK_GROUP_SIZE for optimal values or pass NULL.
+    // size_t local_work_size = 256;
+
+    std::cout << "Device " << device_index << ": Entering continuous kernel execution loop..." << std::endl;
+    LoopStats stats;
+    while (!stats.done()) {
+        auto launch = std::chrono::steady_clock::now();
+        err = clEnqueueNDRangeKernel(queue, kernel, 1, nullptr, &global_work_size, nullptr /* or &local_work_size */, 0, nullptr, nullptr);
+        if (err != CL_SUCCESS) {
+            std::cerr << "Device " << device_index << ": clEnqueueNDRangeKernel failed: " << err << std::endl;
+            // Consider whether to break or retry. For a continuous load, breaking might be okay if error is persistent.
+            break;
+        }
+        // clFinish ensures the kernel completes before the C++ loop re-enqueues it.
+        // This makes the load more "serial" in terms of C++ loop iterations,
+        // but the GPU is kept busy during each kernel's execution.
+        err = clFinish(queue);
+        if (err != CL_SUCCESS) {
+            std::cerr << "Device " << device_index << ": clFinish failed: " << err << std::endl;
+            break;
+        }
+        stats.record(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - launch).count());
+        // No sleep needed if you want to keep the GPU as busy as possible by immediately re-queueing.
+        // std::this_thread::sleep_for(std::chrono::milliseconds(1)); // Optional small delay
+    }
+
+    std::cout << "Device " << device_index << ": Exited kernel execution loop." << std::endl;
+    clFinish(queue); // Drain anything still queued after an error before releasing
+    print_loop_summary(device_index, get_device_name(device), stats, static_cast<double>(dataSizeElements), "elements");
+    clReleaseMemObject(buffer);
+    clReleaseKernel(kernel);
+    clReleaseProgram(program);
+    clReleaseCommandQueue(queue);
+    clReleaseContext(context);
+    std::cout << "Finished load and cleaned up for Device " << device_index << std::endl;
+}
+
+// Picks the largest power-of-two element count of `element_size` bytes that fits both the
+// requested --size-mb footprint and the device's single-allocation limit. Returns log2(count).
+cl_uint pick_pow2_elements(cl_device_id device, size_t element_size, cl_uint min_bits) {
+    cl_ulong max_alloc = 0;
+    clGetDeviceInfo(device, CL_DEVICE_MAX_MEM_ALLOC_SIZE, sizeof(max_alloc), &max_alloc, nullptr);
+    size_t bytes = g_options.size_mb * 1024 * 1024;
+    if (max_alloc > 0 && bytes > max_alloc) bytes = static_cast<size_t>(max_alloc);
+    size_t max_elements = bytes / element_size;
+    cl_uint bits = 0;
+    while (bits < 31 && (size_t(2) << bits) <= max_elements) ++bits;
+    return bits < min_bits ? min_bits : bits;
+}
+
+void run_access_on_device(cl_platform_id platform, cl_device_id device, int device_index) {
+    cl_int err;
+    std::string name = get_device_name(device);
+    std::cout << "Starting access pattern benchmark on Device " << device_index << ": " << name << std::endl;
+
+    cl_context context = create_context(platform, device);
+    cl_command_queue queue = create_queue(context, device, device_index, CL_QUEUE_PROFILING_ENABLE);
+    cl_program program = build_program(context, device, device_index, accessKernelSource, "-cl-std=CL1.2");
+
+    cl_uint bits = pick_pow2_elements(device, sizeof(float), 10);
+    cl_uint count = 1u << bits;
+    cl_uint width = 1u << ((bits + 1) / 2);
+    cl_uint height = count / width;
+    size_t bytes = sizeof(float) * count;
+
+    cl_mem src = clCreateBuffer(context, CL_MEM_READ_WRITE, bytes, nullptr, &err);
+    check_cl_error(err, "clCreateBuffer(src)");
+    cl_mem dst = clCreateBuffer(context, CL_MEM_READ_WRITE, bytes, nullptr, &err);
+    check_cl_error(err, "clCreateBuffer(dst)");
+    cl_mem indices = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(cl_uint) * count, nullptr, &err);
+    check_cl_error(err, "clCreateBuffer(indices)");
+
+    size_t global_1d = count;
+    cl_kernel init = clCreateKernel(program, "access_init", &err);
+    check_cl_error(err, "clCreateKernel(access_init)");
+    check_cl_error(clSetKernelArg(init, 0, sizeof(cl_mem), &src), "clSetKernelArg(src)");
+    check_cl_error(clSetKernelArg(init, 1, sizeof(cl_mem), &indices), "clSetKernelArg(indices)");
+    check_cl_error(clSetKernelArg(init, 2, sizeof(cl_uint), &count), "clSetKernelArg(count)");
+    check_cl_error(clSetKernelArg(init, 3, sizeof(cl_uint), &bits), "clSetKernelArg(bits)");
+    check_cl_error(clEnqueueNDRangeKernel(queue, init, 1, nullptr, &global_1d, nullptr, 0, nullptr, nullptr), "clEnqueueNDRangeKernel(access_init)");
+    check_cl_error(clFinish(queue), "clFinish(access_init)");
+    clReleaseKernel(init);
+
+    struct AccessResult {
+        std::string pattern;
+        double ms;
+        double bytes_moved;
+    };
+    std::vector<AccessResult> results;
+
+    cl_kernel stride_kernel = clCreateKernel(program, "access_stride", &err);
+    check_cl_error(err, "clCreateKernel(access_stride)");
+    check_cl_error(clSetKernelArg(stride_kernel, 0, sizeof(cl_mem), &src), "clSetKernelArg(src)");
+    check_cl_error(clSetKernelArg(stride_kernel, 1, sizeof(cl_mem), &dst), "clSetKernelArg(dst)");
+    check_cl_error(clSetKernelArg(stride_kernel, 2, sizeof(cl_uint), &count), "clSetKernelArg(count)");
+    for (cl_uint stride : {1u, 2u, 4u, 8u, 16u, 32u, 64u}) {
+        check_cl_error(clSetKernelArg(stride_kernel, 3, sizeof(cl_uint), &stride), "clSetKernelArg(stride)");
+        double ms = time_kernel_ms(queue, stride_kernel, 1, &global_1d, nullptr, g_options.repeat);
+        results.push_back({stride == 1 ? "unit" : "stride-" + std::to_string(stride), ms, 2.0 * bytes});
+    }
+    clReleaseKernel(stride_kernel);
+
+    for (const char* kernel_name : {"access_gather", "access_scatter"}) {
+        cl_kernel kernel = clCreateKernel(program, kernel_name, &err);
+        check_cl_error(err, "clCreateKernel(gather/scatter)");
+        check_cl_error(clSetKernelArg(kernel, 0, sizeof(cl_mem), &src), "clSetKernelArg(src)");
+        check_cl_error(clSetKernelArg(kernel, 1, sizeof(cl_mem), &dst), "clSetKernelArg(dst)");
+        check_cl_error(clSetKernelArg(kernel, 2, sizeof(cl_mem), &indices), "clSetKernelArg(indices)");
+        check_cl_error(clSetKernelArg(kernel, 3, sizeof(cl_uint), &count), "clSetKernelArg(count)");
+        double ms = time_kernel_ms(queue, kernel, 1, &global_1d, nullptr, g_options.repeat);
+        // Index reads count towards the traffic: a real gather has to fetch them too.
+        results.push_back({kernel_name + 7, ms, 3.0 * bytes});
+        clReleaseKernel(kernel);
+    }
+
+    size_t global_2d[2] = {width, height};
+    for (const char* kernel_name : {"access_transpose2d", "access_transpose2d_local"}) {
+        cl_kernel kernel = clCreateKernel(program, kernel_name, &err);
+        check_cl_error(err, "clCreateKernel(2d)");
+        check_cl_error(clSetKernelArg(kernel, 0, sizeof(cl_mem), &src), "clSetKernelArg(src)");
+        check_cl_error(clSetKernelArg(kernel, 1, sizeof(cl_mem), &dst), "clSetKernelArg(dst)");
+        check_cl_error(clSetKernelArg(kernel, 2, sizeof(cl_uint), &width), "clSetKernelArg(width)");
+        check_cl_error(clSetKernelArg(kernel, 3, sizeof(cl_uint), &height), "clSetKernelArg(height)");
+        size_t max_wg = 0;
+        clGetKernelWorkGroupInfo(kernel, device, CL_KERNEL_WORK_GROUP_SIZE, sizeof(max_wg), &max_wg, nullptr);
+        size_t tile = max_wg >= 256 ? 16 : 8;
+        size_t local_2d[2] = {tile, tile};
+        double ms = time_kernel_ms(queue, kernel, 2, global_2d, local_2d, g_options.repeat);
+        results.push_back({kernel_name + 7, ms, 2.0 * bytes});
+        clReleaseKernel(kernel);
+    }
+
+    std::ostringstream report;
+    report << "Device " << device_index << " (" << name << ") access patterns, "
+           << (bytes >> 20) << " MB per buffer, " << width << "x" << height << " for 2D:\n";
+    report << "  " << std::left << std::setw(19) << "pattern" << std::right << std::setw(12) << "time (ms)"
+           << std::setw(12) << "GB/s" << std::setw(12) << "vs unit" << "\n";
+    double unit_gbps = results.front().bytes_moved / (results.front().ms * 1e6);
+    for (const auto& r : results) {
+        double gbps = r.bytes_moved / (r.ms * 1e6);
+        report << "  " << std::left << std::setw(19) << r.pattern << std::right << std::fixed
+               << std::setprecision(3) << std::setw(12) << r.ms
+               << std::setprecision(1) << std::setw(12) << gbps
+               << std::setprecision(2) << std::setw(11) << gbps / unit_gbps << "x\n";
+    }
+    {
+        std::lock_guard<std::mutex> lock(g_output_mutex);
+        std::cout << report.str() << std::flush;
+    }
+
+    clReleaseMemObject(indices);
+    clReleaseMemObject(dst);
+    clReleaseMemObject(src);
+    clReleaseProgram(program);
+    clReleaseCommandQueue(queue);
+    clReleaseContext(context);
+}
+
+void run_local_mem_on_device(cl_platform_id platform, cl_device_id device, int device_index) {
+    cl_int err;
+    std::string name = get_device_name(device);
+    std::cout << "Starting local memory benchmark on Device " << device_index << ": " << name << std::endl;
+
+    cl_ulong local_mem = 0;
+    cl_uint compute_units = 0;
+    size_t device_max_wg = 0;
+    clGetDeviceInfo(device, CL_DEVICE_LOCAL_MEM_SIZE, sizeof(local_mem), &local_mem, nullptr);
+    clGetDeviceInfo(device, CL_DEVICE_MAX_COMPUTE_UNITS, sizeof(compute_units), &compute_units, nullptr);
+    clGetDeviceInfo(device, CL_DEVICE_MAX_WORK_GROUP_SIZE, sizeof(device_max_wg), &device_max_wg, nullptr);
+
+    // 16 KB of words is enough to show bank behaviour and fits every device we run on.
+    cl_uint local_elems = 4096;
+    while (local_elems * sizeof(cl_uint) > local_mem / 2 && local_elems > 256) local_elems /= 2;
+
+    cl_context context = create_context(platform, device);
+    cl_command_queue queue = create_queue(context, device, device_index, CL_QUEUE_PROFILING_ENABLE);
+    std::string build_options = "-cl-std=CL1.2 -DLOCAL_ELEMS=" + std::to_string(local_elems) +
+                                " -DMAX_WG=" + std::to_string(device_max_wg);
+    cl_program program = build_program(context, device, device_index, localMemKernelSource, build_options);
+
+    size_t out_elements = static_cast<size_t>(compute_units) * 8 * device_max_wg;
+    cl_mem out = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(float) * out_elements, nullptr, &err);
+    check_cl_error(err, "clCreateBuffer(out)");
+
+    std::ostringstream report;
+    report << "Device " << device_index << " (" << name << ") local memory, "
+           << local_elems * sizeof(cl_uint) / 1024 << " KB tile, " << compute_units << " compute units:\n";
+
+    // Bandwidth across strides: 8 groups per compute unit keeps every EU busy.
+    cl_kernel bandwidth = clCreateKernel(program, "local_bandwidth", &err);
+    check_cl_error(err, "clCreateKernel(local_bandwidth)");
+    size_t bw_wg = 0;
+    clGetKernelWorkGroupInfo(bandwidth, device, CL_KERNEL_WORK_GROUP_SIZE, sizeof(bw_wg), &bw_wg, nullptr);
+    if (bw_wg > 256) bw_wg = 256;
+    size_t bw_global = static_cast<size_t>(compute_units) * 8 * bw_wg;
+    cl_uint bw_iterations = 4096;
+    check_cl_error(clSetKernelArg(bandwidth, 0, sizeof(cl_mem), &out), "clSetKernelArg(out)");
+    check_cl_error(clSetKernelArg(bandwidth, 2, sizeof(cl_uint), &bw_iterations), "clSetKernelArg(bw_iterations)");
+    report << "  " << std::left << std::setw(10) << "stride" << std::right << std::setw(12) << "time (ms)"
+           << std::setw(12) << "GB/s" << std::setw(12) << "vs stride 1" << "\n";
+    double stride1_gbps = 0.0;
+    for (cl_uint stride : {1u, 2u, 4u, 8u, 16u, 32u, 64u, 33u}) {
+        check_cl_error(clSetKernelArg(bandwidth, 1, sizeof(cl_uint), &stride), "clSetKernelArg(stride)");
+        double ms = time_kernel_ms(queue, bandwidth, 1, &bw_global, &bw_wg, g_options.repeat);
+        double gbps = static_cast<double>(bw_global) * bw_iterations * sizeof(float) / (ms * 1e6);
+        if (stride == 1) stride1_gbps = gbps;
+        report << "  " << std::left << std::setw(10) << stride << std::right << std::fixed
+               << std::setprecision(3) << std::setw(12) << ms
+               << std::setprecision(1) << std::setw(12) << gbps
+               << std::setprecision(2) << std::setw(11) << gbps / stride1_gbps << "x\n";
+    }
+    clReleaseKernel(bandwidth);
+
+    // Latency: one chasing work-item per compute unit, the rest of the group only fills the chain.
+    cl_kernel latency = clCreateKernel(program, "local_latency", &err);
+    check_cl_error(err, "clCreateKernel(local_latency)");
+    size_t lat_wg = 64 < device_max_wg ? 64 : device_max_wg;
+    size_t lat_global = static_cast<size_t>(compute_units) * lat_wg;
+    cl_uint lat_iterations = 1u << 20;
+    cl_uint lat_step = 33; // Odd, so the chain visits every slot and consecutive hops change bank
+    check_cl_error(clSetKernelArg(latency, 0, sizeof(cl_mem), &out), "clSetKernelArg(out)");
+    check_cl_error(clSetKernelArg(latency, 1, sizeof(cl_uint), &lat_iterations), "clSetKernelArg(lat_iterations)");
+    check_cl_error(clSetKernelArg(latency, 2, sizeof(cl_uint), &lat_step), "clSetKernelArg(lat_step)");
+    double lat_ms = time_kernel_ms(queue, latency, 1, &lat_global, &lat_wg, g_options.repeat);
+    report << "  latency: " << std::fixed << std::setprecision(2) << lat_ms * 1e6 / lat_iterations << " ns per dependent load\n";
+    clReleaseKernel(latency);
+
+    // Barrier cost: one group per compute unit so the figure is the latency of a single group's barrier.
+    cl_kernel with_barrier = clCreateKernel(program, "local_barrier", &err);
+    check_cl_error(err, "clCreateKernel(local_barrier)");
+    cl_kernel without_barrier = clCreateKernel(program, "local_no_barrier", &err);
+    check_cl_error(err, "clCreateKernel(local_no_barrier)");
+    size_t barrier_max_wg = 0;
+    clGetKernelWorkGroupInfo(with_barrier, device, CL_KERNEL_WORK_GROUP_SIZE, sizeof(barrier_max_wg), &barrier_max_wg, nullptr);
+    cl_uint barrier_iterations = 16384;
+    for (cl_kernel kernel : {with_barrier, without_barrier}) {
+        check_cl_error(clSetKernelArg(kernel, 0, sizeof(cl_mem), &out), "clSetKernelArg(out)");
+        check_cl_error(clSetKernelArg(kernel, 1, sizeof(cl_uint), &barrier_iterations), "clSetKernelArg(barrier_iterations)");
+    }
+    report << "  " << std::left << std::setw(10) << "wg size" << std::right << std::setw(16) << "ns/barrier" << "\n";
+    for (size_t wg = 16; wg <= barrier_max_wg; wg *= 2) {
+        size_t global = static_cast<size_t>(compute_units) * wg;
+        double barrier_ms = time_kernel_ms(queue, with_barrier, 1, &global, &wg, g_options.repeat);
+        double plain_ms = time_kernel_ms(queue, without_barrier, 1, &global, &wg, g_options.repeat);
+        double ns = (barrier_ms - plain_ms) * 1e6 / (2.0 * barrier_iterations);
+        report << "  " << std::left << std::setw(10) << wg << std::right << std::fixed
+               << std::setprecision(2) << std::setw(16) << (ns > 0.0 ? ns : 0.0) << "\n";
+    }
+    clReleaseKernel(without_barrier);
+    clReleaseKernel(with_barrier);
+
+    {
+        std::lock_guard<std::mutex> lock(g_output_mutex);
+        std::cout << report.str() << std::flush;
+    }
+
+    clReleaseMemObject(out);
+    clReleaseProgram(program);
+    clReleaseCommandQueue(queue);
+    clReleaseContext(context);
+}
+
+void run_atomics_on_device(cl_platform_id platform, cl_device_id device, int device_index) {
+    cl_int err;
+    std::string name = get_device_name(device);
+    std::cout << "Starting atomics contention benchmark on Device " << device_index << ": " << name << std::endl;
+
+    cl_uint compute_units = 0;
+    clGetDeviceInfo(device, CL_DEVICE_MAX_COMPUTE_UNITS, sizeof(compute_units), &compute_units, nullptr);
+    const cl_uint local_bins = 1024;
+
+    cl_context context = create_context(platform, device);
+    cl_command_queue queue = create_queue(context, device, device_index, CL_QUEUE_PROFILING_ENABLE);
+    cl_program program = build_program(context, device, device_index, atomicKernelSource,
+                                       "-cl-std=CL1.2 -DLOCAL_BINS=" + std::to_string(local_bins));
+
+    const size_t wg = 256;
+    size_t global = static_cast<size_t>(compute_units) * 8 * wg;
+    cl_mem bins = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(cl_int) * global, nullptr, &err);
+    check_cl_error(err, "clCreateBuffer(bins)");
+
+    // Native float add needs OpenCL C 2.0 atomics and a device that reports it for that scope.
+    cl_bitfield fp_atomics = 0;
+    if (device_cl_version(device) >= 20 && device_has_extension(device, "cl_ext_float_atomics")) {
+        clGetDeviceInfo(device, CL_DEVICE_SINGLE_FP_ATOMIC_CAPABILITIES_EXT, sizeof(fp_atomics), &fp_atomics, nullptr);
+    }
+    bool native_global = fp_atomics & CL_DEVICE_GLOBAL_FP_ATOMIC_ADD_EXT;
+    bool native_local = fp_atomics & CL_DEVICE_LOCAL_FP_ATOMIC_ADD_EXT;
+    cl_program native_program = nullptr;
+    std::string native_note = "; no native float add (cl_ext_float_atomics)";
+    if (native_global || native_local) {
+        std::string options = cl_std_option(device) + " -DLOCAL_BINS=" + std::to_string(local_bins);
+        if (native_global) options += " -DNATIVE_GLOBAL_ADD";
+        if (native_local) options += " -DNATIVE_LOCAL_ADD";
+        std::string source = std::string(atomicKernelSource) + atomicNativeFloatKernelSource;
+        try {
+            native_program = build_program(context, device, device_index, source.c_str(), options);
+            native_note = "";
+        } catch (const std::runtime_error& e) {
+            native_global = native_local = false;
+            native_note = std::string("; native float add build failed: ") + e.what();
+        }
+    }
+
+    std::ostringstream report;
+    report << "Device " << device_index << " (" << name << ") atomics, " << global << " work-items"
+           << native_note << ":\n"
+           << "  float CAS = compare-and-swap emulation, which a kernel would only use without native float add.\n";
+    report << "  " << std::left << std::setw(8) << "scope" << std::setw(11) << "type" << std::right
+           << std::setw(10) << "targets" << std::setw(12) << "Gatomic/s" << "  check\n";
+
+    struct AtomicCase {
+        const char* kernel_name;
+        const char* scope;
+        const char* type;
+        bool is_int;
+        bool is_local;
+        cl_uint iterations;
+        cl_program program;
+    };
+    std::vector<AtomicCase> cases = {
+        {"atomic_global_int", "global", "int", true, false, 64, program},
+        {"atomic_global_float", "global", "float CAS", false, false, 16, program},
+        {"atomic_local_int", "local", "int", true, true, 256, program},
+        {"atomic_local_float", "local", "float CAS", false, true, 64, program},
+    };
+    if (native_global) cases.insert(cases.begin() + 2, {"atomic_global_float_native", "global", "float", false, false, 16, native_program});
+    if (native_local) cases.push_back({"atomic_local_float_native", "local", "float", false, true, 64, native_program});
+    for (const AtomicCase& c : cases) {
+        cl_kernel kernel = clCreateKernel(c.program, c.kernel_name, &err);
+        check_cl_error(err, "clCreateKernel(atomics)");
+        size_t kernel_wg = 0;
+        clGetKernelWorkGroupInfo(kernel, device, CL_KERNEL_WORK_GROUP_SIZE, sizeof(kernel_wg), &kernel_wg, nullptr);
+        if (kernel_wg < wg) {
+            report << "  " << c.kernel_name << ": skipped, kernel work-group limit " << kernel_wg << " < " << wg << "\n";
+            clReleaseKernel(kernel);
+            continue;
+        }
+        check_cl_error(clSetKernelArg(kernel, 0, sizeof(cl_mem), &bins), "clSetKernelArg(bins)");
+        check_cl_error(clSetKernelArg(kernel, 2, sizeof(cl_uint), &c.iterations), "clSetKernelArg(iterations)");
+
+        // Local targets are bounded by the private bin array and by the group size.
+        size_t max_targets = c.is_local ? (local_bins < wg ? local_bins : wg) : global;
+        std::vector<cl_uint> target_counts;
+        for (size_t t = 1; t < max_targets; t *= 4) target_counts.push_back(static_cast<cl_uint>(t));
+        target_counts.push_back(static_cast<cl_uint>(max_targets));
+
+        for (cl_uint targets : target_counts) {
+            check_cl_error(clSetKernelArg(kernel, 1, sizeof(cl_uint), &targets), "clSetKernelArg(targets)");
+            cl_int zero = 0;
+            check_cl_error(clEnqueueFillBuffer(queue, bins, &zero, sizeof(zero), 0, sizeof(cl_int) * targets, 0, nullptr, nullptr),
+                           "clEnqueueFillBuffer(bins)");
+            double ms = time_kernel_ms(queue, kernel, 1, &global, &wg, g_options.repeat);
+            double ops = static_cast<double>(global) * c.iterations;
+
+            // Every launch adds exactly global * iterations, so the integer bins can be checked.
+            // Compared modulo 2^32, since a single hot bin wraps after enough repeats.
+            std::string check = "-";
+            if (c.is_int) {
+                std::vector<cl_uint> host_bins(targets);
+                check_cl_error(clEnqueueReadBuffer(queue, bins, CL_TRUE, 0, sizeof(cl_uint) * targets, host_bins.data(), 0, nullptr, nullptr),
+                               "clEnqueueReadBuffer(bins)");
+                cl_uint sum = 0;
+                for (cl_uint v : host_bins) sum += v;
+                cl_uint expected = static_cast<cl_uint>(static_cast<unsigned long long>(global) * c.iterations * (g_options.repeat + 1));
+                check = sum == expected ? "ok" : "MISMATCH";
+            }
+            report << "  " << std::left << std::setw(8) << c.scope << std::setw(11) << c.type << std::right
+                   << std::setw(10) << targets << std::fixed << std::setprecision(3)
+                   << std::setw(12) << ops / (ms * 1e6) << "  " << check << "\n";
+        }
+        clReleaseKernel(kernel);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(g_output_mutex);
+        std::cout << report.str() << std::flush;
+    }
+
+    clReleaseMemObject(bins);
+    if (native_program) clReleaseProgram(native_program);
+    clReleaseProgram(program);
+    clReleaseCommandQueue(queue);
+    clReleaseContext(context);
+}
+
+void run_subgroups_on_device(cl_platform_id platform, cl_device_id device, int device_index) {
+    cl_int err;
+    std::string name = get_device_name(device);
+    std::cout << "Starting subgroup benchmark on Device " << device_index << ": " << name << std::endl;
+
+    bool intel_subgroups = device_has_extension(device, "cl_intel_subgroups");
+    if (!intel_subgroups && !device_has_extension(device, "cl_khr_subgroups")) {
+        std::lock_guard<std::mutex> lock(g_output_mutex);
+        std::cout << "Device " << device_index << " (" << name << "): no cl_khr_subgroups or cl_intel_subgroups, skipping." << std::endl;
+        return;
+    }
+
+    std::vector<size_t> sg_sizes = forceable_subgroup_sizes(device);
+
+    cl_uint compute_units = 0;
+    clGetDeviceInfo(device, CL_DEVICE_MAX_COMPUTE_UNITS, sizeof(compute_units), &compute_units, nullptr);
+    const size_t wg = 256;
+    size_t global = static_cast<size_t>(compute_units) * 8 * wg;
+    const cl_uint iterations = 256;
+    const cl_uint block_iterations = 16;
+
+    cl_context context = create_context(platform, device);
+    cl_command_queue queue = create_queue(context, device, device_index, CL_QUEUE_PROFILING_ENABLE);
+
+    std::vector<float> host_in(global);
+    for (size_t i = 0; i < global; ++i) host_in[i] = static_cast<float>(i % 97) * 0.01f;
+    cl_mem in = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(float) * global, nullptr, &err);
+    check_cl_error(err, "clCreateBuffer(in)");
+    PinnedPool pool;
+    create_pinned_pool(pool, context, device, std::min(sizeof(float) * global, kUploadStagingBytes), g_options.huge_pages);
+    upload_through_pinned(queue, pool, in, host_in.data(), sizeof(float) * global);
+    release_pinned_pool(pool);
+    cl_mem blocks = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(float) * global * block_iterations, nullptr, &err);
+    check_cl_error(err, "clCreateBuffer(blocks)");
+    float one = 1.0f;
+    check_cl_error(clEnqueueFillBuffer(queue, blocks, &one, sizeof(one), 0, sizeof(float) * global * block_iterations, 0, nullptr, nullptr),
+                   "clEnqueueFillBuffer(blocks)");
+    cl_mem out_sg = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(float) * global, nullptr, &err);
+    check_cl_error(err, "clCreateBuffer(out_sg)");
+    cl_mem out_ref = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(float) * global, nullptr, &err);
+    check_cl_error(err, "clCreateBuffer(out_ref)");
+
+    std::ostringstream report;
+    report << "Device " << device_index << " (" << name << ") subgroups, " << global << " work-items, "
+           << (intel_subgroups ? "cl_intel_subgroups" : "cl_khr_subgroups") << ":\n";
+    report << "  " << std::left << std::setw(6) << "simd" << std::setw(12) << "op" << std::right
+           << std::setw(14) << "subgroup G/s" << std::setw(14) << "local G/s" << std::setw(10) << "speedup" << "  match\n";
+
+    struct SubgroupOp {
+        const char* label;
+        const char* sg_kernel;
+        const char* ref_kernel;
+        bool intel_only;
+        bool block;
+    };
+    const SubgroupOp ops[] = {
+        {"reduce", "sg_reduce", "local_reduce", false, false},
+        {"scan", "sg_scan", "local_scan", false, false},
+        {"broadcast", "sg_broadcast", "local_broadcast", false, false},
+        {"shuffle", "sg_shuffle", "local_shuffle", true, false},
+        {"block_read", "sg_block_read", "plain_block_read", true, true},
+    };
+
+    for (size_t sg_size : sg_sizes) {
+        std::string options = cl_std_option(device) + " -DWG=" + std::to_string(wg);
+        if (sg_size) options += " -DSG_SIZE=" + std::to_string(sg_size);
+        if (intel_subgroups) options += " -DHAS_INTEL_SUBGROUPS";
+        std::string simd = sg_size ? std::to_string(sg_size) : "auto";
+        cl_program program;
+        try {
+            program = build_program(context, device, device_index, subgroupKernelSource, options);
+        } catch (const std::runtime_error& e) {
+            report << "  " << std::left << std::setw(6) << simd << "build failed: " << e.what() << "\n";
+            continue;
+        }
+
+        for (const SubgroupOp& op : ops) {
+            if (op.intel_only && !intel_subgroups) continue;
+            cl_kernel kernels[2];
+            kernels[0] = clCreateKernel(program, op.sg_kernel, &err);
+            check_cl_error(err, "clCreateKernel(subgroup)");
+            kernels[1] = clCreateKernel(program, op.ref_kernel, &err);
+            check_cl_error(err, "clCreateKernel(subgroup reference)");
+            cl_mem outputs[2] = {out_sg, out_ref};
+            cl_uint op_iterations = op.block ? block_iterations : iterations;
+            double ms[2] = {0.0, 0.0};
+            bool runnable = true;
+            for (int k = 0; k < 2; ++k) {
+                size_t kernel_wg = 0;
+                clGetKernelWorkGroupInfo(kernels[k], device, CL_KERNEL_WORK_GROUP_SIZE, sizeof(kernel_wg), &kernel_wg, nullptr);
+                if (kernel_wg < wg) {
+                    runnable = false;
+                    break;
+                }
+                check_cl_error(clSetKernelArg(kernels[k], 0, sizeof(cl_mem), op.block ? &blocks : &in), "clSetKernelArg(input)");
+                check_cl_error(clSetKernelArg(kernels[k], 1, sizeof(cl_mem), &outputs[k]), "clSetKernelArg(outputs)");
+                check_cl_error(clSetKernelArg(kernels[k], 2, sizeof(cl_uint), &op_iterations), "clSetKernelArg(op_iterations)");
+                ms[k] = time_kernel_ms(queue, kernels[k], 1, &global, &wg, g_options.repeat);
+            }
+            clReleaseKernel(kernels[0]);
+            clReleaseKernel(kernels[1]);
+            if (!runnable) {
+                report << "  " << std::left << std::setw(6) << simd << std::setw(12) << op.label << "skipped, work-group limit below " << wg << "\n";
+                continue;
+            }
+
+            // Both kernels compute the same values; reduction order may differ slightly.
+            std::vector<float> sg_result(global), ref_result(global);
+            check_cl_error(clEnqueueReadBuffer(queue, out_sg, CL_TRUE, 0, sizeof(float) * global, sg_result.data(), 0, nullptr, nullptr),
+                           "clEnqueueReadBuffer(out_sg)");
+            check_cl_error(clEnqueueReadBuffer(queue, out_ref, CL_TRUE, 0, sizeof(float) * global, ref_result.data(), 0, nullptr, nullptr),
+                           "clEnqueueReadBuffer(out_ref)");
+            bool match = true;
+            for (size_t i = 0; i < global && match; ++i) {
+                match = std::fabs(sg_result[i] - ref_result[i]) <= 1e-3f * (1.0f + std::fabs(ref_result[i]));
+            }
+
+            double ops_count = static_cast<double>(global) * op_iterations;
+            report << "  " << std::left << std::setw(6) << simd << std::setw(12) << op.label << std::right << std::fixed
+                   << std::setprecision(2) << std::setw(14) << ops_count / (ms[0] * 1e6)
+                   << std::setw(14) << ops_count / (ms[1] * 1e6)
+                   << std::setw(9) << ms[1] / ms[0] << "x  " << (match ? "ok" : "MISMATCH") << "\n";
+        }
+        clReleaseProgram(program);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(g_output_mutex);
+        std::cout << report.str() << std::flush;
+    }
+
+    clReleaseMemObject(out_ref);
+    clReleaseMemObject(out_sg);
+    clReleaseMemObject(blocks);
+    clReleaseMemObject(in);
+    clReleaseCommandQueue(queue);
+    clReleaseContext(context);
+}
+
+cl_sampler create_sampler(cl_context context, cl_filter_mode filter) {
+    cl_int err;
+    cl_sampler_properties props[] = {CL_SAMPLER_NORMALIZED_COORDS, CL_TRUE,
+                                     CL_SAMPLER_ADDRESSING_MODE, CL_ADDRESS_CLAMP_TO_EDGE,
+                                     CL_SAMPLER_FILTER_MODE, filter, 0};
+    cl_sampler sampler = clCreateSamplerWithProperties(context, props, &err);
+    if (err != CL_SUCCESS) { // Same fallback as for command queues on pre-2.0 runtimes
+        sampler = clCreateSampler(context, CL_TRUE, CL_ADDRESS_CLAMP_TO_EDGE, filter, &err);
+    }
+    check_cl_error(err, "clCreateSampler(WithProperties)");
+    return sampler;
+}
+
+bool image_format_supported(cl_context context, cl_mem_flags flags, cl_mem_object_type type, const cl_image_format& format) {
+    cl_uint count = 0;
+    if (clGetSupportedImageFormats(context, flags, type, 0, nullptr, &count) != CL_SUCCESS || count == 0) return false;
+    std::vector<cl_image_format> formats(count);
+    clGetSupportedImageFormats(context, flags, type, count, formats.data(), nullptr);
+    for (const cl_image_format& f : formats) {
+        if (f.image_channel_order == format.image_channel_order && f.image_channel_data_type == format.image_channel_data_type) return true;
+    }
+    return false;
+}
+
+void run_images_on_device(cl_platform_id platform, cl_device_id device, int device_index) {
+    cl_int err;
+    std::string name = get_device_name(device);
+    std::cout << "Starting image/sampler benchmark on Device " << device_index << ": " << name << std::endl;
+
+    cl_bool image_support = CL_FALSE;
+    clGetDeviceInfo(device, CL_DEVICE_IMAGE_SUPPORT, sizeof(image_support), &image_support, nullptr);
+    if (!image_support) {
+        std::lock_guard<std::mutex> lock(g_output_mutex);
+        std::cout << "Device " << device_index << " (" << name << "): no image support, skipping." << std::endl;
+        return;
+    }
+    size_t max_2d = 0, max_3d = 0;
+    clGetDeviceInfo(device, CL_DEVICE_IMAGE2D_MAX_WIDTH, sizeof(max_2d), &max_2d, nullptr);
+    clGetDeviceInfo(device, CL_DEVICE_IMAGE3D_MAX_WIDTH, sizeof(max_3d), &max_3d, nullptr);
+    size_t side_2d = max_2d < 4096 ? max_2d : 4096;
+    size_t side_3d = max_3d < 256 ? max_3d : 256;
+
+    cl_context context = create_context(platform, device);
+    cl_command_queue queue = create_queue(context, device, device_index, CL_QUEUE_PROFILING_ENABLE);
+    cl_program program = build_program(context, device, device_index, imageKernelSource, "-cl-std=CL1.2");
+    cl_sampler samplers[2] = {create_sampler(context, CL_FILTER_NEAREST), create_sampler(context, CL_FILTER_LINEAR)};
+    const char* filter_names[2] = {"nearest", "linear"};
+
+    struct ImageFormat {
+        const char* label;
+        cl_image_format format;
+        size_t texel_bytes;
+    };
+    const ImageFormat formats[] = {
+        {"rgba8", {CL_RGBA, CL_UNORM_INT8}, 4},
+        {"rgba16f", {CL_RGBA, CL_HALF_FLOAT}, 8},
+        {"rgba32f", {CL_RGBA, CL_FLOAT}, 16},
+        {"r32f", {CL_R, CL_FLOAT}, 4},
+    };
+
+    std::ostringstream report;
+    report << "Device " << device_index << " (" << name << ") images, 2D " << side_2d << "^2, 3D " << side_3d << "^3:\n";
+    report << "  " << std::left << std::setw(8) << "dims" << std::setw(10) << "format" << std::setw(9) << "filter"
+           << std::right << std::setw(12) << "Gtexel/s" << std::setw(10) << "GB/s" << "\n";
+    auto add_row = [&](const char* dims, const char* format, const char* filter, double texels, double bytes, double ms) {
+        report << "  " << std::left << std::setw(8) << dims << std::setw(10) << format << std::setw(9) << filter
+               << std::right << std::fixed << std::setprecision(2) << std::setw(12) << texels / (ms * 1e6)
+               << std::setprecision(1) << std::setw(10) << bytes / (ms * 1e6) << "\n";
+    };
+
+    cl_kernel sample2d = clCreateKernel(program, "image2d_sample", &err);
+    check_cl_error(err, "clCreateKernel(image2d_sample)");
+    cl_kernel sample3d = clCreateKernel(program, "image3d_sample", &err);
+    check_cl_error(err, "clCreateKernel(image3d_sample)");
+    size_t texels_2d = side_2d * side_2d;
+    size_t texels_3d = side_3d * side_3d * side_3d;
+    cl_mem out3d = clCreateBuffer(context, CL_MEM_WRITE_ONLY, sizeof(cl_float) * 4 * texels_3d, nullptr, &err);
+    check_cl_error(err, "clCreateBuffer(out3d)");
+    const float fill_color[4] = {0.25f, 0.5f, 0.75f, 1.0f};
+
+    for (const ImageFormat& f : formats) {
+        // 2D: image to image through the sampler
+        if (image_format_supported(context, CL_MEM_READ_ONLY, CL_MEM_OBJECT_IMAGE2D, f.format) &&
+            image_format_supported(context, CL_MEM_WRITE_ONLY, CL_MEM_OBJECT_IMAGE2D, f.format)) {
+            cl_image_desc desc = {};
+            desc.image_type = CL_MEM_OBJECT_IMAGE2D;
+            desc.image_width = side_2d;
+            desc.image_height = side_2d;
+            cl_mem src = clCreateImage(context, CL_MEM_READ_ONLY, &f.format, &desc, nullptr, &err);
+            check_cl_error(err, "clCreateImage(2D src)");
+            cl_mem dst = clCreateImage(context, CL_MEM_WRITE_ONLY, &f.format, &desc, nullptr, &err);
+            check_cl_error(err, "clCreateImage(2D dst)");
+            size_t origin[3] = {0, 0, 0};
+            size_t region[3] = {side_2d, side_2d, 1};
+            check_cl_error(clEnqueueFillImage(queue, src, fill_color, origin, region, 0, nullptr, nullptr), "clEnqueueFillImage(2D)");
+            check_cl_error(clSetKernelArg(sample2d, 0, sizeof(cl_mem), &src), "clSetKernelArg(src)");
+            check_cl_error(clSetKernelArg(sample2d, 1, sizeof(cl_mem), &dst), "clSetKernelArg(dst)");
+            size_t global[2] = {side_2d, side_2d};
+            for (int filter = 0; filter < 2; ++filter) {
+                check_cl_error(clSetKernelArg(sample2d, 2, sizeof(cl_sampler), &samplers[filter]), "clSetKernelArg(samplers)");
+                double ms = time_kernel_ms(queue, sample2d, 2, global, nullptr, g_options.repeat);
+                add_row("2D", f.label, filter_names[filter], static_cast<double>(texels_2d), 2.0 * texels_2d * f.texel_bytes, ms);
+            }
+            clReleaseMemObject(dst);
+            clReleaseMemObject(src);
+        } else {
+            report << "  " << std::left << std::setw(8) << "2D" << std::setw(10) << f.label << "unsupported\n";
+        }
+
+        // 3D: volume sampled into a float4 buffer
+        if (side_3d > 0 && image_format_supported(context, CL_MEM_READ_ONLY, CL_MEM_OBJECT_IMAGE3D, f.format)) {
+            cl_image_desc desc = {};
+            desc.image_type = CL_MEM_OBJECT_IMAGE3D;
+            desc.image_width = side_3d;
+            desc.image_height = side_3d;
+            desc.image_depth = side_3d;
+            cl_mem src = clCreateImage(context, CL_MEM_READ_ONLY, &f.format, &desc, nullptr, &err);
+            check_cl_error(err, "clCreateImage(3D src)");
+            size_t origin[3] = {0, 0, 0};
+            size_t region[3] = {side_3d, side_3d, side_3d};
+            check_cl_error(clEnqueueFillImage(queue, src, fill_color, origin, region, 0, nullptr, nullptr), "clEnqueueFillImage(3D)");
+            check_cl_error(clSetKernelArg(sample3d, 0, sizeof(cl_mem), &src), "clSetKernelArg(src)");
+            check_cl_error(clSetKernelArg(sample3d, 1, sizeof(cl_mem), &out3d), "clSetKernelArg(out3d)");
+            size_t global[3] = {side_3d, side_3d, side_3d};
+            for (int filter = 0; filter < 2; ++filter) {
+                check_cl_error(clSetKernelArg(sample3d, 2, sizeof(cl_sampler), &samplers[filter]), "clSetKernelArg(samplers)");
+                double ms = time_kernel_ms(queue, sample3d, 3, global, nullptr, g_options.repeat);
+                add_row("3D", f.label, filter_names[filter], static_cast<double>(texels_3d),
+                        static_cast<double>(texels_3d) * (f.texel_bytes + 4 * sizeof(cl_float)), ms);
+            }
+            clReleaseMemObject(src);
+        } else {
+            report << "  " << std::left << std::setw(8) << "3D" << std::setw(10) << f.label << "unsupported\n";
+        }
+    }
+
+    // Buffer baseline for the rgba32f 2D case: same footprint, plain loads instead of the sampler.
+    cl_mem buffer_src = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_float) * 4 * texels_2d, nullptr, &err);
+    check_cl_error(err, "clCreateBuffer(buffer_src)");
+    cl_mem buffer_dst = clCreateBuffer(context, CL_MEM_WRITE_ONLY, sizeof(cl_float) * 4 * texels_2d, nullptr, &err);
+    check_cl_error(err, "clCreateBuffer(buffer_dst)");
+    check_cl_error(clEnqueueFillBuffer(queue, buffer_src, fill_color, sizeof(fill_color), 0, sizeof(cl_float) * 4 * texels_2d, 0, nullptr, nullptr),
+                   "clEnqueueFillBuffer(buffer_src)");
+    cl_int width = static_cast<cl_int>(side_2d);
+    size_t global_2d[2] = {side_2d, side_2d};
+    const char* buffer_kernels[2] = {"buffer2d_nearest", "buffer2d_linear"};
+    for (int filter = 0; filter < 2; ++filter) {
+        cl_kernel kernel = clCreateKernel(program, buffer_kernels[filter], &err);
+        check_cl_error(err, "clCreateKernel(buffer2d)");
+        check_cl_error(clSetKernelArg(kernel, 0, sizeof(cl_mem), &buffer_src), "clSetKernelArg(buffer_src)");
+        check_cl_error(clSetKernelArg(kernel, 1, sizeof(cl_mem), &buffer_dst), "clSetKernelArg(buffer_dst)");
+        check_cl_error(clSetKernelArg(kernel, 2, sizeof(cl_int), &width), "clSetKernelArg(width)");
+        if (filter == 1) check_cl_error(clSetKernelArg(kernel, 3, sizeof(cl_int), &width), "clSetKernelArg(width)");
+        double ms = time_kernel_ms(queue, kernel, 2, global_2d, nullptr, g_options.repeat);
+        add_row("2D", "buf32f", filter_names[filter], static_cast<double>(texels_2d), 2.0 * texels_2d * 4 * sizeof(cl_float), ms);
+        clReleaseKernel(kernel);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(g_output_mutex);
+        std::cout << report.str() << std::flush;
+    }
+
+    clReleaseMemObject(buffer_dst);
+    clReleaseMemObject(buffer_src);
+    clReleaseMemObject(out3d);
+    clReleaseKernel(sample3d);
+    clReleaseKernel(sample2d);
+    clReleaseSampler(samplers[1]);
+    clReleaseSampler(samplers[0]);
+    clReleaseProgram(program);
+    clReleaseCommandQueue(queue);
+    clReleaseContext(context);
+}
+
+// Host copy of hashedValueKernelSource, so GEMM, FFT and sparse results can be checked on
+// the host without staging the inputs.
+float hashed_test_value(cl_uint index, cl_uint seed) {
+    cl_uint h = (index * 0x9E3779B1u) ^ seed;
+    h ^= h >> 15;
+    h *= 0x85EBCA6Bu;
+    h ^= h >> 13;
+    return static_cast<float>(static_cast<int>(h % 17u) - 8) * 0.125f;
+}
+
+void run_gemm_on_device(cl_platform_id platform, cl_device_id device, int device_index) {
+    cl_int err;
+    std::string name = get_device_name(device);
+    std::cout << "Starting GEMM benchmark on Device " << device_index << ": " << name << std::endl;
+
+    const cl_uint tile = 16;
+    const cl_uint seed_a = 0x1234u, seed_b = 0xabcdu;
+    bool has_fp16 = device_has_extension(device, "cl_khr_fp16");
+    bool has_xmx = has_fp16 && device_has_extension(device, "cl_intel_subgroup_matrix_multiply_accumulate");
+
+    cl_context context = create_context(platform, device);
+    cl_command_queue queue = create_queue(context, device, device_index, CL_QUEUE_PROFILING_ENABLE);
+    std::string options = "-cl-std=CL1.2 -DTILE=" + std::to_string(tile);
+    if (has_fp16) options += " -DHAS_FP16";
+    std::string source = std::string(hashedValueKernelSource) + gemmKernelSource;
+    cl_program program;
+    if (has_xmx) {
+        // The matrix builtins need the subgroup-size attribute; fall back if the compiler refuses it.
+        try {
+            program = build_program(context, device, device_index, source.c_str(), options + " -DHAS_XMX");
+        } catch (const std::runtime_error&) {
+            has_xmx = false;
+        }
+    }
+    if (!has_xmx) program = build_program(context, device, device_index, source.c_str(), options);
+
+    std::ostringstream report;
+    report << "Device " << device_index << " (" << name << ") GEMM, tiled " << tile << "x" << tile
+           << (has_fp16 ? ", fp16" : ", no fp16") << (has_xmx ? ", XMX" : ", no XMX") << ":\n";
+    report << "  " << std::left << std::setw(8) << "n" << std::setw(10) << "kernel" << std::right
+           << std::setw(12) << "time (ms)" << std::setw(10) << "TFLOPS" << "  check\n";
+
+    struct GemmVariant {
+        const char* label;
+        const char* kernel_name;
+        const char* init_a;
+        const char* init_b;
+        size_t element_size;
+        bool enabled;
+    };
+    const GemmVariant variants[] = {
+        {"fp32", "gemm_tiled_f32", "gemm_init_f32", "gemm_init_f32", sizeof(cl_float), true},
+        {"fp16", "gemm_tiled_f16", "gemm_init_f16", "gemm_init_f16", sizeof(cl_half), has_fp16},
+        {"xmx-fp16", "gemm_xmx_f16", "gemm_init_f16", "gemm_init_f16_vnni", sizeof(cl_half), has_xmx},
+    };
+
+    for (cl_uint n = 256; static_cast<size_t>(n) * n * sizeof(cl_float) <= g_options.size_mb * 1024 * 1024; n *= 2) {
+        size_t elements = static_cast<size_t>(n) * n;
+        cl_mem c = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(cl_float) * elements, nullptr, &err);
+        check_cl_error(err, "clCreateBuffer(C)");
+
+        for (const GemmVariant& v : variants) {
+            if (!v.enabled) continue;
+            cl_mem a = clCreateBuffer(context, CL_MEM_READ_ONLY, v.element_size * elements, nullptr, &err);
+            check_cl_error(err, "clCreateBuffer(A)");
+            cl_mem b = clCreateBuffer(context, CL_MEM_READ_ONLY, v.element_size * elements, nullptr, &err);
+            check_cl_error(err, "clCreateBuffer(B)");
+
+            // Generate inputs on the device
+            cl_mem init_targets[2] = {a, b};
+            const char* init_names[2] = {v.init_a, v.init_b};
+            cl_uint seeds[2] = {seed_a, seed_b};
+            for (int m = 0; m < 2; ++m) {
+                cl_kernel init = clCreateKernel(program, init_names[m], &err);
+                check_cl_error(err, "clCreateKernel(gemm_init)");
+                check_cl_error(clSetKernelArg(init, 0, sizeof(cl_mem), &init_targets[m]), "clSetKernelArg(init_targets)");
+                check_cl_error(clSetKernelArg(init, 1, sizeof(cl_uint), &seeds[m]), "clSetKernelArg(seeds)");
+                if (std::strcmp(init_names[m], "gemm_init_f16_vnni") == 0) {
+                    check_cl_error(clSetKernelArg(init, 2, sizeof(cl_uint), &n), "clSetKernelArg(n)");
+                }
+                check_cl_error(clEnqueueNDRangeKernel(queue, init, 1, nullptr, &elements, nullptr, 0, nullptr, nullptr),
+                               "clEnqueueNDRangeKernel(gemm_init)");
+                clReleaseKernel(init);
+            }
+
+            cl_kernel kernel = clCreateKernel(program, v.kernel_name, &err);
+            check_cl_error(err, "clCreateKernel(gemm)");
+            check_cl_error(clSetKernelArg(kernel, 0, sizeof(cl_mem), &a), "clSetKernelArg(a)");
+            check_cl_error(clSetKernelArg(kernel, 1, sizeof(cl_mem), &b), "clSetKernelArg(b)");
+            check_cl_error(clSetKernelArg(kernel, 2, sizeof(cl_mem), &c), "clSetKernelArg(c)");
+            check_cl_error(clSetKernelArg(kernel, 3, sizeof(cl_uint), &n), "clSetKernelArg(n)");
+            bool xmx = std::strcmp(v.kernel_name, "gemm_xmx_f16") == 0;
+            size_t global[2] = {n, xmx ? n / 8 : n};
+            size_t local[2] = {xmx ? 64u : tile, xmx ? 1u : tile};
+            double ms = time_kernel_ms(queue, kernel, 2, global, local, g_options.repeat);
+            clReleaseKernel(kernel);
+
+            // Spot-check a hashed sample of C against a host dot product.
+            std::vector<cl_float> host_c(elements);
+            check_cl_error(clEnqueueReadBuffer(queue, c, CL_TRUE, 0, sizeof(cl_float) * elements, host_c.data(), 0, nullptr, nullptr),
+                           "clEnqueueReadBuffer(C)");
+            bool ok = true;
+            for (cl_uint sample = 0; sample < 256 && ok; ++sample) {
+                cl_uint idx = static_cast<cl_uint>((sample * 2654435761u) % elements);
+                cl_uint row = idx / n, col = idx % n;
+                double expected = 0.0;
+                for (cl_uint k = 0; k < n; ++k) {
+                    expected += static_cast<double>(hashed_test_value(row * n + k, seed_a)) * hashed_test_value(k * n + col, seed_b);
+                }
+                ok = std::fabs(host_c[idx] - expected) <= 1e-3 * (1.0 + std::fabs(expected));
+            }
+
+            double tflops = 2.0 * n * n * static_cast<double>(n) / (ms * 1e9);
+            report << "  " << std::left << std::setw(8) << n << std::setw(10) << v.label << std::right << std::fixed
+                   << std::setprecision(3) << std::setw(12) << ms << std::setw(10) << tflops
+                   << "  " << (ok ? "ok" : "MISMATCH") << "\n";
+            clReleaseMemObject(b);
+            clReleaseMemObject(a);
+        }
+        clReleaseMemObject(c);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(g_output_mutex);
+        std::cout << report.str() << std::flush;
+    }
+
+    clReleaseProgram(program);
+    clReleaseCommandQueue(queue);
+    clReleaseContext(context);
+}
+
+// In-place iterative radix-2 FFT in double precision, the reference for the device stages.
+void host_fft(std::vector<std::complex<double>>& a) {
+    size_t n = a.size();
+    for (size_t i = 1, j = 0; i < n; ++i) {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j ^= bit;
+        if (i < j) std::swap(a[i], a[j]);
+    }
+    for (size_t len = 2; len <= n; len <<= 1) {
+        double angle = -2.0 * M_PI / static_cast<double>(len);
+        std::complex<double> step(std::cos(angle), std::sin(angle));
+        for (size_t i = 0; i < n; i += len) {
+            std::complex<double> w(1.0, 0.0);
+            for (size_t k = 0; k < len / 2; ++k) {
+                std::complex<double> u = a[i + k], v = a[i + k + len / 2] * w;
+                a[i + k] = u + v;
+                a[i + k + len / 2] = u - v;
+                w *= step;
+            }
+        }
+    }
+}
+
+void run_fft_on_device(cl_platform_id platform, cl_device_id device, int device_index) {
+    cl_int err;
+    std::string name = get_device_name(device);
+    std::cout << "Starting FFT benchmark on Device " << device_index << ": " << name << std::endl;
+
+    const cl_uint seed = 0x5eedu;
+    cl_uint n = static_cast<cl_uint>(g_options.fft_size);
+    size_t transform_bytes = sizeof(cl_float) * 2 * n;
+    cl_ulong max_alloc = 0;
+    clGetDeviceInfo(device, CL_DEVICE_MAX_MEM_ALLOC_SIZE, sizeof(max_alloc), &max_alloc, nullptr);
+    size_t batch = g_options.fft_batch ? g_options.fft_batch : g_options.size_mb * 1024 * 1024 / transform_bytes;
+    if (batch * transform_bytes > max_alloc) batch = static_cast<size_t>(max_alloc / transform_bytes);
+    if (batch == 0) batch = 1;
+    size_t total = batch * n;
+
+    cl_context context = create_context(platform, device);
+    cl_command_queue queue = create_queue(context, device, device_index, CL_QUEUE_PROFILING_ENABLE);
+    std::string source = std::string(hashedValueKernelSource) + fftKernelSource;
+    cl_program program = build_program(context, device, device_index, source.c_str(), "-cl-std=CL1.2");
+
+    // The input is kept separate from the ping-pong pair so every repetition starts from it.
+    cl_mem input = clCreateBuffer(context, CL_MEM_READ_WRITE, transform_bytes * batch, nullptr, &err);
+    check_cl_error(err, "clCreateBuffer(input)");
+    cl_mem work[2];
+    for (cl_mem& buffer : work) {
+        buffer = clCreateBuffer(context, CL_MEM_READ_WRITE, transform_bytes * batch, nullptr, &err);
+        check_cl_error(err, "clCreateBuffer(work)");
+    }
+    cl_kernel init = clCreateKernel(program, "fft_init", &err);
+    check_cl_error(err, "clCreateKernel(fft_init)");
+    check_cl_error(clSetKernelArg(init, 0, sizeof(cl_mem), &input), "clSetKernelArg(input)");
+    check_cl_error(clSetKernelArg(init, 1, sizeof(cl_uint), &seed), "clSetKernelArg(seed)");
+    check_cl_error(clEnqueueNDRangeKernel(queue, init, 1, nullptr, &total, nullptr, 0, nullptr, nullptr), "clEnqueueNDRangeKernel(fft_init)");
+    check_cl_error(clFinish(queue), "clFinish(fft_init)");
+    clReleaseKernel(init);
+
+    // Host references for the first and last transform of the batch
+    std::vector<size_t> checked = {0, batch - 1};
+    std::vector<std::vector<std::complex<double>>> references;
+    for (size_t b : checked) {
+        std::vector<std::complex<double>> ref(n);
+        for (cl_uint i = 0; i < n; ++i) {
+            cl_uint index = static_cast<cl_uint>(b * n + i);
+            ref[i] = {hashed_test_value(2 * index, seed), hashed_test_value(2 * index + 1, seed)};
+        }
+        host_fft(ref);
+        references.push_back(ref);
+    }
+
+    std::ostringstream report;
+    report << "Device " << device_index << " (" << name << ") FFT, " << n << " points x " << batch << " transforms:\n";
+    report << "  " << std::left << std::setw(8) << "radix" << std::setw(14) << "stages" << std::right
+           << std::setw(12) << "time (ms)" << std::setw(10) << "GFLOPS" << std::setw(12) << "max error" << "\n";
+
+    double log2n = std::log2(static_cast<double>(n));
+    for (cl_uint radix : {2u, 4u, 8u}) {
+        // Largest radix first, finishing with smaller ones when log2(n) is not a multiple
+        std::vector<cl_uint> stages;
+        for (cl_uint remaining = n; remaining > 1;) {
+            cl_uint r = radix;
+            while (remaining % r) r /= 2;
+            stages.push_back(r);
+            remaining /= r;
+        }
+        std::vector<cl_kernel> kernels;
+        cl_uint ns = 1;
+        for (size_t s = 0; s < stages.size(); ++s) {
+            cl_kernel kernel = clCreateKernel(program, ("fft_radix" + std::to_string(stages[s])).c_str(), &err);
+            check_cl_error(err, "clCreateKernel(fft_radix)");
+            cl_mem src = s == 0 ? input : work[(s + 1) % 2];
+            check_cl_error(clSetKernelArg(kernel, 0, sizeof(cl_mem), &src), "clSetKernelArg(src)");
+            check_cl_error(clSetKernelArg(kernel, 1, sizeof(cl_mem), &work[s % 2]), "clSetKernelArg(work)");
+            check_cl_error(clSetKernelArg(kernel, 2, sizeof(cl_uint), &n), "clSetKernelArg(n)");
+            check_cl_error(clSetKernelArg(kernel, 3, sizeof(cl_uint), &ns), "clSetKernelArg(ns)");
+            kernels.push_back(kernel);
+            ns *= stages[s];
+        }
+        cl_mem result = work[(stages.size() - 1) % 2];
+
+        // Time the whole stage chain: first stage start to last stage end
+        double total_ms = 0.0;
+        for (int rep = 0; rep <= g_options.repeat; ++rep) {
+            cl_event first = nullptr, last = nullptr;
+            for (size_t s = 0; s < kernels.size(); ++s) {
+                size_t global[2] = {n / stages[s], batch};
+                cl_event* event = s == 0 ? &first : (s + 1 == kernels.size() ? &last : nullptr);
+                check_cl_error(clEnqueueNDRangeKernel(queue, kernels[s], 2, nullptr, global, nullptr, 0, nullptr, event),
+                               "clEnqueueNDRangeKernel(fft_radix)");
+            }
+            check_cl_error(clFinish(queue), "clFinish(fft)");
+            if (!last) last = first; // Single-stage transforms
+            cl_ulong start = 0, end = 0;
+            clGetEventProfilingInfo(first, CL_PROFILING_COMMAND_START, sizeof(start), &start, nullptr);
+            clGetEventProfilingInfo(last, CL_PROFILING_COMMAND_END, sizeof(end), &end, nullptr);
+            if (last != first) clReleaseEvent(last);
+            clReleaseEvent(first);
+            if (rep > 0) total_ms += (end - start) * 1e-6; // Repetition 0 is the warmup
+        }
+        double ms = total_ms / g_options.repeat;
+        for (cl_kernel kernel : kernels) clReleaseKernel(kernel);
+
+        // Error relative to the largest reference magnitude
+        double max_error = 0.0;
+        for (size_t c = 0; c < checked.size(); ++c) {
+            std::vector<cl_float> device_result(2 * n);
+            check_cl_error(clEnqueueReadBuffer(queue, result, CL_TRUE, transform_bytes * checked[c], transform_bytes,
+                                               device_result.data(), 0, nullptr, nullptr),
+                           "clEnqueueReadBuffer(fft)");
+            double max_ref = 1e-30, max_diff = 0.0;
+            for (cl_uint i = 0; i < n; ++i) {
+                std::complex<double> got(device_result[2 * i], device_result[2 * i + 1]);
+                max_ref = std::max(max_ref, std::abs(references[c][i]));
+                max_diff = std::max(max_diff, std::abs(got - references[c][i]));
+            }
+            max_error = std::max(max_error, max_diff / max_ref);
+        }
+
+        std::string plan;
+        for (cl_uint r : stages) plan += (plan.empty() ? "" : "x") + std::to_string(r);
+        double gflops = 5.0 * n * log2n * batch / (ms * 1e6);
+        report << "  " << std::left << std::setw(8) << radix << std::setw(14) << plan << std::right << std::fixed
+               << std::setprecision(3) << std::setw(12) << ms << std::setprecision(1) << std::setw(10) << gflops
+               << std::scientific << std::setprecision(2) << std::setw(12) << max_error
+               << (max_error < 1e-4 ? "  ok" : "  MISMATCH") << "\n";
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(g_output_mutex);
+        std::cout << report.str() << std::flush;
+    }
+
+    clReleaseMemObject(work[1]);
+    clReleaseMemObject(work[0]);
+    clReleaseMemObject(input);
+    clReleaseProgram(program);
+    clReleaseCommandQueue(queue);
+    clReleaseContext(context);
+}
+
+// Undirected power-law graph in CSR form, generated with the Graph500 R-MAT recipe.
+struct CsrGraph {
+    cl_uint vertices = 0;
+    std::vector<cl_uint> row_ptr;
+    std::vector<cl_uint> cols;
+};
+
+CsrGraph generate_rmat_graph(cl_uint scale, cl_uint edge_factor, cl_uint seed) {
+    CsrGraph graph;
+    graph.vertices = 1u << scale;
+    size_t edges = static_cast<size_t>(graph.vertices) * edge_factor;
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    std::vector<std::pair<cl_uint, cl_uint>> edge_list;
+    edge_list.reserve(edges);
+    for (size_t e = 0; e < edges; ++e) {
+        cl_uint src = 0, dst = 0;
+        for (cl_uint level = 0; level < scale; ++level) {
+            // Quadrant probabilities a=0.57, b=0.19, c=0.19, d=0.05
+            double r = uniform(rng);
+            cl_uint src_bit = r >= 0.76 ? 1 : 0;
+            cl_uint dst_bit = (r >= 0.57 && r < 0.76) || r >= 0.95 ? 1 : 0;
+            src |= src_bit << level;
+            dst |= dst_bit << level;
+        }
+        if (src != dst) edge_list.push_back({src, dst});
+    }
+
+    // Both directions of every edge, bucketed by source
+    graph.row_ptr.assign(graph.vertices + 1, 0);
+    for (const auto& e : edge_list) {
+        ++graph.row_ptr[e.first + 1];
+        ++graph.row_ptr[e.second + 1];
+    }
+    for (cl_uint v = 0; v < graph.vertices; ++v) graph.row_ptr[v + 1] += graph.row_ptr[v];
+    graph.cols.resize(graph.row_ptr.back());
+    std::vector<cl_uint> fill(graph.row_ptr.begin(), graph.row_ptr.end() - 1);
+    for (const auto& e : edge_list) {
+        graph.cols[fill[e.first]++] = e.second;
+        graph.cols[fill[e.second]++] = e.first;
+    }
+    return graph;
+}
+
+void run_sparse_on_device(cl_platform_id platform, cl_device_id device, int device_index) {
+    cl_int err;
+    std::string name = get_device_name(device);
+    std::cout << "Starting SpMV/BFS benchmark on Device " << device_index << ": " << name << std::endl;
+
+    // Scale the graph so the CSR arrays use about a quarter of device memory, capped so host
+    // generation stays in the seconds range. Each undirected edge is stored twice (index + value).
+    const cl_uint edge_factor = 16;
+    cl_ulong global_mem = 0, max_alloc = 0;
+    clGetDeviceInfo(device, CL_DEVICE_GLOBAL_MEM_SIZE, sizeof(global_mem), &global_mem, nullptr);
+    clGetDeviceInfo(device, CL_DEVICE_MAX_MEM_ALLOC_SIZE, sizeof(max_alloc), &max_alloc, nullptr);
+    cl_uint scale = 10;
+    while (scale < 21) {
+        cl_ulong next_nnz = 2ull * edge_factor << (scale + 1);
+        if (next_nnz * 8 > global_mem / 4 || next_nnz * 4 > max_alloc) break;
+        ++scale;
+    }
+    auto generate_start = std::chrono::steady_clock::now();
+    CsrGraph graph = generate_rmat_graph(scale, edge_factor, 42u + device_index);
+    double generate_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - generate_start).count();
+    cl_uint rows = graph.vertices;
+    size_t nnz = graph.cols.size();
+
+    std::vector<cl_float> values(nnz), x(rows);
+    for (size_t e = 0; e < nnz; ++e) values[e] = hashed_test_value(static_cast<cl_uint>(e), 0x51u);
+    for (cl_uint v = 0; v < rows; ++v) x[v] = hashed_test_value(v, 0x52u);
+
+    const cl_uint row_lanes = 16;
+    const size_t wg = 128;
+    cl_context context = create_context(platform, device);
+    cl_command_queue queue = create_queue(context, device, device_index, CL_QUEUE_PROFILING_ENABLE);
+    cl_program program = build_program(context, device, device_index, sparseKernelSource,
+                                       "-cl-std=CL1.2 -DWG=" + std::to_string(wg) + " -DROW_LANES=" + std::to_string(row_lanes));
+
+    // The CSR arrays are up to a quarter of device memory, so they are staged through a bounded pinned pool.
+    PinnedPool pool;
+    create_pinned_pool(pool, context, device, std::min(sizeof(cl_uint) * nnz, kUploadStagingBytes), g_options.huge_pages);
+    auto create_input = [&](size_t bytes, const void* data, const char* what) {
+        cl_mem buffer = clCreateBuffer(context, CL_MEM_READ_ONLY, bytes, nullptr, &err);
+        check_cl_error(err, what);
+        upload_through_pinned(queue, pool, buffer, data, bytes);
+        return buffer;
+    };
+    cl_mem row_ptr = create_input(sizeof(cl_uint) * (rows + 1), graph.row_ptr.data(), "clCreateBuffer(row_ptr)");
+    cl_mem cols = create_input(sizeof(cl_uint) * nnz, graph.cols.data(), "clCreateBuffer(cols)");
+    cl_mem vals = create_input(sizeof(cl_float) * nnz, values.data(), "clCreateBuffer(values)");
+    cl_mem x_buffer = create_input(sizeof(cl_float) * rows, x.data(), "clCreateBuffer(x)");
+    release_pinned_pool(pool);
+    cl_mem y_buffer = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(cl_float) * rows, nullptr, &err);
+    check_cl_error(err, "clCreateBuffer(y)");
+
+    std::ostringstream report;
+    report << "Device " << device_index << " (" << name << ") R-MAT scale " << scale << ": " << rows << " vertices, "
+           << nnz << " directed edges (generated in " << std::fixed << std::setprecision(1) << generate_s << " s):\n";
+
+    // SpMV, checked row by row against the host
+    std::vector<double> y_ref(rows, 0.0);
+    for (cl_uint r = 0; r < rows; ++r) {
+        for (cl_uint e = graph.row_ptr[r]; e < graph.row_ptr[r + 1]; ++e) y_ref[r] += static_cast<double>(values[e]) * x[graph.cols[e]];
+    }
+    for (const char* kernel_name : {"spmv_csr_scalar", "spmv_csr_vector"}) {
+        cl_kernel kernel = clCreateKernel(program, kernel_name, &err);
+        check_cl_error(err, "clCreateKernel(spmv)");
+        cl_mem args[5] = {row_ptr, cols, vals, x_buffer, y_buffer};
+        for (cl_uint a = 0; a < 5; ++a) check_cl_error(clSetKernelArg(kernel, a, sizeof(cl_mem), &args[a]), "clSetKernelArg(args)");
+        check_cl_error(clSetKernelArg(kernel, 5, sizeof(cl_uint), &rows), "clSetKernelArg(rows)");
+        bool vector = std::strcmp(kernel_name, "spmv_csr_vector") == 0;
+        size_t items = vector ? static_cast<size_t>(rows) * row_lanes : rows;
+        size_t global = (items + wg - 1) / wg * wg;
+        double ms = time_kernel_ms(queue, kernel, 1, &global, &wg, g_options.repeat);
+        clReleaseKernel(kernel);
+
+        std::vector<cl_float> y(rows);
+        check_cl_error(clEnqueueReadBuffer(queue, y_buffer, CL_TRUE, 0, sizeof(cl_float) * rows, y.data(), 0, nullptr, nullptr),
+                       "clEnqueueReadBuffer(y)");
+        bool ok = true;
+        for (cl_uint r = 0; r < rows && ok; ++r) ok = std::fabs(y[r] - y_ref[r]) <= 1e-3 * (1.0 + std::fabs(y_ref[r]));
+        report << "  " << std::left << std::setw(18) << kernel_name << std::right << std::fixed << std::setprecision(3)
+               << std::setw(10) << ms << " ms" << std::setprecision(2) << std::setw(10) << 2.0 * nnz / (ms * 1e6) << " GFLOPS"
+               << std::setw(10) << (sizeof(cl_uint) * 2 + sizeof(cl_float) * 2) * static_cast<double>(nnz) / (ms * 1e6) << " GB/s  "
+               << (ok ? "ok" : "MISMATCH") << "\n";
+    }
+
+    // BFS from a few random non-isolated roots; the host times the whole level loop, including
+    // the per-level frontier size readback a real traversal needs.
+    cl_mem levels = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(cl_int) * rows, nullptr, &err);
+    check_cl_error(err, "clCreateBuffer(levels)");
+    cl_mem frontiers[2];
+    for (cl_mem& f : frontiers) {
+        f = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(cl_uint) * rows, nullptr, &err);
+        check_cl_error(err, "clCreateBuffer(frontier)");
+    }
+    cl_mem next_size = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(cl_uint), nullptr, &err);
+    check_cl_error(err, "clCreateBuffer(next_size)");
+    cl_kernel expand = clCreateKernel(program, "bfs_expand", &err);
+    check_cl_error(err, "clCreateKernel(bfs_expand)");
+    check_cl_error(clSetKernelArg(expand, 0, sizeof(cl_mem), &row_ptr), "clSetKernelArg(row_ptr)");
+    check_cl_error(clSetKernelArg(expand, 1, sizeof(cl_mem), &cols), "clSetKernelArg(cols)");
+    check_cl_error(clSetKernelArg(expand, 2, sizeof(cl_mem), &levels), "clSetKernelArg(levels)");
+
+    std::mt19937 root_rng(7);
+    for (int search = 0; search < 4; ++search) {
+        cl_uint root;
+        do root = root_rng() % rows; while (graph.row_ptr[root + 1] == graph.row_ptr[root]);
+
+        cl_int unvisited = -1, root_level = 0;
+        cl_uint zero = 0;
+        check_cl_error(clEnqueueFillBuffer(queue, levels, &unvisited, sizeof(unvisited), 0, sizeof(cl_int) * rows, 0, nullptr, nullptr),
+                       "clEnqueueFillBuffer(levels)");
+        check_cl_error(clEnqueueWriteBuffer(queue, levels, CL_FALSE, sizeof(cl_int) * root, sizeof(cl_int), &root_level, 0, nullptr, nullptr),
+                       "clEnqueueWriteBuffer(root level)");
+        check_cl_error(clEnqueueWriteBuffer(queue, frontiers[0], CL_TRUE, 0, sizeof(cl_uint), &root, 0, nullptr, nullptr),
+                       "clEnqueueWriteBuffer(root)");
+
+        auto start = std::chrono::steady_clock::now();
+        cl_uint frontier_size = 1;
+        cl_int level = 0;
+        for (; frontier_size > 0; ++level) {
+            check_cl_error(clEnqueueWriteBuffer(queue, next_size, CL_FALSE, 0, sizeof(cl_uint), &zero, 0, nullptr, nullptr),
+                           "clEnqueueWriteBuffer(next_size)");
+            check_cl_error(clSetKernelArg(expand, 3, sizeof(cl_mem), &frontiers[level % 2]), "clSetKernelArg(frontiers)");
+            check_cl_error(clSetKernelArg(expand, 4, sizeof(cl_uint), &frontier_size), "clSetKernelArg(frontier_size)");
+            check_cl_error(clSetKernelArg(expand, 5, sizeof(cl_mem), &frontiers[(level + 1) % 2]), "clSetKernelArg(frontiers)");
+            check_cl_error(clSetKernelArg(expand, 6, sizeof(cl_mem), &next_size), "clSetKernelArg(next_size)");
+            check_cl_error(clSetKernelArg(expand, 7, sizeof(cl_int), &level), "clSetKernelArg(level)");
+            size_t global = (frontier_size + wg - 1) / wg * wg;
+            check_cl_error(clEnqueueNDRangeKernel(queue, expand, 1, nullptr, &global, &wg, 0, nullptr, nullptr),
+                           "clEnqueueNDRangeKernel(bfs_expand)");
+            check_cl_error(clEnqueueReadBuffer(queue, next_size, CL_TRUE, 0, sizeof(cl_uint), &frontier_size, 0, nullptr, nullptr),
+                           "clEnqueueReadBuffer(next_size)");
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        // Host BFS for the reference levels and the Graph500 edge count (undirected edges
+        // inside the reached component)
+        std::vector<cl_int> ref_levels(rows, -1), device_levels(rows);
+        std::vector<cl_uint> queue_host = {root};
+        ref_levels[root] = 0;
+        size_t traversed = 0;
+        for (size_t head = 0; head < queue_host.size(); ++head) {
+            cl_uint v = queue_host[head];
+            traversed += graph.row_ptr[v + 1] - graph.row_ptr[v];
+            for (cl_uint e = graph.row_ptr[v]; e < graph.row_ptr[v + 1]; ++e) {
+                cl_uint u = graph.cols[e];
+                if (ref_levels[u] == -1) {
+                    ref_levels[u] = ref_levels[v] + 1;
+                    queue_host.push_back(u);
+                }
+            }
+        }
+        check_cl_error(clEnqueueReadBuffer(queue, levels, CL_TRUE, 0, sizeof(cl_int) * rows, device_levels.data(), 0, nullptr, nullptr),
+                       "clEnqueueReadBuffer(levels)");
+        bool ok = device_levels == ref_levels;
+        report << "  bfs root " << std::left << std::setw(9) << root << std::right << std::setw(4) << level - 1 << " levels "
+               << std::setw(9) << queue_host.size() << " reached" << std::fixed << std::setprecision(3)
+               << std::setw(10) << seconds * 1e3 << " ms" << std::setprecision(1)
+               << std::setw(9) << traversed / 2.0 / (seconds * 1e6) << " MTEPS  " << (ok ? "ok" : "MISMATCH") << "\n";
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(g_output_mutex);
+        std::cout << report.str() << std::flush;
+    }
+
+    clReleaseKernel(expand);
+    clReleaseMemObject(next_size);
+    clReleaseMemObject(frontiers[1]);
+    clReleaseMemObject(frontiers[0]);
+    clReleaseMemObject(levels);
+    clReleaseMemObject(y_buffer);
+    clReleaseMemObject(x_buffer);
+    clReleaseMemObject(vals);
+    clReleaseMemObject(cols);
+    clReleaseMemObject(row_ptr);
+    clReleaseProgram(program);
+    clReleaseCommandQueue(queue);
+    clReleaseContext(context);
+}
+
+// Buffers and kernels for sorting n keys of one width on one device. Created once per
+// key width and reused across repetitions.
+struct RadixSortPlan {
+    static constexpr cl_uint kRadixBits = 4;
+    static constexpr cl_uint kItems = 256;
+    static constexpr size_t kWorkGroup = 256;
+
+    cl_uint n = 0;
+    cl_uint key_bytes = 0;
+    cl_uint threads = 0;
+    cl_program program = nullptr;
+    cl_kernel init = nullptr, histogram = nullptr, scatter = nullptr;
+    cl_kernel scan_block = nullptr, scan_add = nullptr, check_sorted = nullptr;
+    cl_mem keys[2] = {nullptr, nullptr};
+    cl_mem errors = nullptr;
+    std::vector<cl_mem> scan_levels; // scan_levels[0] holds the digit counts
+    std::vector<cl_uint> scan_sizes;
+};
+
+RadixSortPlan create_radix_sort(cl_context context, cl_device_id device, int device_index, cl_uint n, cl_uint key_bytes) {
+    cl_int err;
+    RadixSortPlan plan;
+    plan.n = n;
+    plan.key_bytes = key_bytes;
+    plan.threads = (n + RadixSortPlan::kItems - 1) / RadixSortPlan::kItems;
+    std::string options = "-cl-std=CL1.2 -DKEY_T=" + std::string(key_bytes == 8 ? "ulong" : "uint") +
+                          " -DRADIX_BITS=" + std::to_string(RadixSortPlan::kRadixBits) +
+                          " -DITEMS=" + std::to_string(RadixSortPlan::kItems) +
+                          " -DWG=" + std::to_string(RadixSortPlan::kWorkGroup);
+    plan.program = build_program(context, device, device_index, radixSortKernelSource, options);
+    std::pair<cl_kernel*, const char*> kernels[] = {
+        {&plan.init, "radix_init"}, {&plan.histogram, "radix_histogram"}, {&plan.scatter, "radix_scatter"},
+        {&plan.scan_block, "scan_block"}, {&plan.scan_add, "scan_add"}, {&plan.check_sorted, "radix_check_sorted"},
+    };
+    for (auto& k : kernels) {
+        *k.first = clCreateKernel(plan.program, k.second, &err);
+        check_cl_error(err, "clCreateKernel(radix sort)");
+    }
+    for (cl_mem& buffer : plan.keys) {
+        buffer = clCreateBuffer(context, CL_MEM_READ_WRITE, static_cast<size_t>(key_bytes) * n, nullptr, &err);
+        check_cl_error(err, "clCreateBuffer(keys)");
+    }
+    plan.errors = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(cl_uint), nullptr, &err);
+    check_cl_error(err, "clCreateBuffer(errors)");
+
+    // One buffer per level of the recursive scan: counts, then block sums of each level.
+    cl_uint size = (1u << RadixSortPlan::kRadixBits) * plan.threads;
+    while (true) {
+        cl_mem level = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(cl_uint) * size, nullptr, &err);
+        check_cl_error(err, "clCreateBuffer(scan level)");
+        plan.scan_levels.push_back(level);
+        plan.scan_sizes.push_back(size);
+        if (size <= 1) break;
+        size = static_cast<cl_uint>((size + RadixSortPlan::kWorkGroup - 1) / RadixSortPlan::kWorkGroup);
+    }
+    return plan;
+}
+
+void release_radix_sort(RadixSortPlan& plan) {
+    for (cl_mem level : plan.scan_levels) clReleaseMemObject(level);
+    clReleaseMemObject(plan.errors);
+    clReleaseMemObject(plan.keys[1]);
+    clReleaseMemObject(plan.keys[0]);
+    for (cl_kernel k : {plan.init, plan.histogram, plan.scatter, plan.scan_block, plan.scan_add, plan.check_sorted}) clReleaseKernel(k);
+    clReleaseProgram(plan.program);
+}
+
+size_t round_up(size_t value, size_t multiple) {
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+void enqueue_exclusive_scan(cl_command_queue queue, RadixSortPlan& plan, size_t level) {
+    cl_uint n = plan.scan_sizes[level];
+    size_t wg = RadixSortPlan::kWorkGroup;
+    size_t global = round_up(n, wg);
+    check_cl_error(clSetKernelArg(plan.scan_block, 0, sizeof(cl_mem), &plan.scan_levels[level]), "clSetKernelArg(scan_levels)");
+    check_cl_error(clSetKernelArg(plan.scan_block, 1, sizeof(cl_mem), &plan.scan_levels[level + 1]), "clSetKernelArg(scan_levels)");
+    check_cl_error(clSetKernelArg(plan.scan_block, 2, sizeof(cl_uint), &n), "clSetKernelArg(n)");
+    check_cl_error(clEnqueueNDRangeKernel(queue, plan.scan_block, 1, nullptr, &global, &wg, 0, nullptr, nullptr),
+                   "clEnqueueNDRangeKernel(scan_block)");
+    if (global / wg > 1) {
+        enqueue_exclusive_scan(queue, plan, level + 1);
+        check_cl_error(clSetKernelArg(plan.scan_add, 0, sizeof(cl_mem), &plan.scan_levels[level]), "clSetKernelArg(scan_levels)");
+        check_cl_error(clSetKernelArg(plan.scan_add, 1, sizeof(cl_mem), &plan.scan_levels[level + 1]), "clSetKernelArg(scan_levels)");
+        check_cl_error(clSetKernelArg(plan.scan_add, 2, sizeof(cl_uint), &n), "clSetKernelArg(n)");
+        check_cl_error(clEnqueueNDRangeKernel(queue, plan.scan_add, 1, nullptr, &global, &wg, 0, nullptr, nullptr),
+                       "clEnqueueNDRangeKernel(scan_add)");
+    }
+}
+
+void enqueue_radix_keys(cl_command_queue queue, RadixSortPlan& plan, cl_uint seed) {
+    size_t global = round_up(plan.n, RadixSortPlan::kWorkGroup);
+    check_cl_error(clSetKernelArg(plan.init, 0, sizeof(cl_mem), &plan.keys[0]), "clSetKernelArg(keys)");
+    check_cl_error(clSetKernelArg(plan.init, 1, sizeof(cl_uint), &plan.n), "clSetKernelArg(n)");
+    check_cl_error(clSetKernelArg(plan.init, 2, sizeof(cl_uint), &seed), "clSetKernelArg(seed)");
+    check_cl_error(clEnqueueNDRangeKernel(queue, plan.init, 1, nullptr, &global, &RadixSortPlan::kWorkGroup, 0, nullptr, nullptr),
+                   "clEnqueueNDRangeKernel(radix_init)");
+}
+
+// Sorts plan.keys[0] in place (an even number of passes ends back in keys[0]).
+void enqueue_radix_sort(cl_command_queue queue, RadixSortPlan& plan) {
+    size_t wg = RadixSortPlan::kWorkGroup;
+    size_t global = round_up(plan.threads, wg);
+    cl_uint passes = plan.key_bytes * 8 / RadixSortPlan::kRadixBits;
+    for (cl_uint pass = 0; pass < passes; ++pass) {
+        cl_uint shift = pass * RadixSortPlan::kRadixBits;
+        cl_mem src = plan.keys[pass % 2], dst = plan.keys[(pass + 1) % 2];
+        check_cl_error(clSetKernelArg(plan.histogram, 0, sizeof(cl_mem), &src), "clSetKernelArg(src)");
+        check_cl_error(clSetKernelArg(plan.histogram, 1, sizeof(cl_mem), &plan.scan_levels[0]), "clSetKernelArg(scan_levels)");
+        check_cl_error(clSetKernelArg(plan.histogram, 2, sizeof(cl_uint), &plan.n), "clSetKernelArg(n)");
+        check_cl_error(clSetKernelArg(plan.histogram, 3, sizeof(cl_uint), &shift), "clSetKernelArg(shift)");
+        check_cl_error(clSetKernelArg(plan.histogram, 4, sizeof(cl_uint), &plan.threads), "clSetKernelArg(threads)");
+        check_cl_error(clEnqueueNDRangeKernel(queue, plan.histogram, 1, nullptr, &global, &wg, 0, nullptr, nullptr),
+                       "clEnqueueNDRangeKernel(radix_histogram)");
+        enqueue_exclusive_scan(queue, plan, 0);
+        check_cl_error(clSetKernelArg(plan.scatter, 0, sizeof(cl_mem), &src), "clSetKernelArg(src)");
+        check_cl_error(clSetKernelArg(plan.scatter, 1, sizeof(cl_mem), &dst), "clSetKernelArg(dst)");
+        check_cl_error(clSetKernelArg(plan.scatter, 2, sizeof(cl_mem), &plan.scan_levels[0]), "clSetKernelArg(scan_levels)");
+        check_cl_error(clSetKernelArg(plan.scatter, 3, sizeof(cl_uint), &plan.n), "clSetKernelArg(n)");
+        check_cl_error(clSetKernelArg(plan.scatter, 4, sizeof(cl_uint), &shift), "clSetKernelArg(shift)");
+        check_cl_error(clSetKernelArg(plan.scatter, 5, sizeof(cl_uint), &plan.threads), "clSetKernelArg(threads)");
+        check_cl_error(clEnqueueNDRangeKernel(queue, plan.scatter, 1, nullptr, &global, &wg, 0, nullptr, nullptr),
+                       "clEnqueueNDRangeKernel(radix_scatter)");
+    }
+}
+
+// Counts adjacent out-of-order pairs on the device; only the count comes back.
+cl_uint count_unsorted_keys(cl_command_queue queue, RadixSortPlan& plan) {
+    cl_uint errors = 0;
+    check_cl_error(clEnqueueWriteBuffer(queue, plan.errors, CL_FALSE, 0, sizeof(errors), &errors, 0, nullptr, nullptr),
+                   "clEnqueueWriteBuffer(errors)");
+    size_t global = round_up(plan.n, RadixSortPlan::kWorkGroup);
+    check_cl_error(clSetKernelArg(plan.check_sorted, 0, sizeof(cl_mem), &plan.keys[0]), "clSetKernelArg(keys)");
+    check_cl_error(clSetKernelArg(plan.check_sorted, 1, sizeof(cl_uint), &plan.n), "clSetKernelArg(n)");
+    check_cl_error(clSetKernelArg(plan.check_sorted, 2, sizeof(cl_mem), &plan.errors), "clSetKernelArg(errors)");
+    check_cl_error(clEnqueueNDRangeKernel(queue, plan.check_sorted, 1, nullptr, &global, &RadixSortPlan::kWorkGroup, 0, nullptr, nullptr),
+                   "clEnqueueNDRangeKernel(radix_check_sorted)");
+    check_cl_error(clEnqueueReadBuffer(queue, plan.errors, CL_TRUE, 0, sizeof(errors), &errors, 0, nullptr, nullptr),
+                   "clEnqueueReadBuffer(errors)");
+    return errors;
+}
+
+cl_uint radix_sort_key_count(cl_device_id device, cl_uint key_bytes) {
+    cl_ulong max_alloc = 0;
+    clGetDeviceInfo(device, CL_DEVICE_MAX_MEM_ALLOC_SIZE, sizeof(max_alloc), &max_alloc, nullptr);
+    size_t bytes = g_options.size_mb * 1024 * 1024;
+    if (bytes > max_alloc) bytes = static_cast<size_t>(max_alloc);
+    size_t n = bytes / key_bytes;
+    return static_cast<cl_uint>(n > 0xffffffffu ? 0xffffffffu : n);
+}
+
+void run_sort_on_device(cl_platform_id platform, cl_device_id device, int device_index) {
+    std::string name = get_device_name(device);
+    std::cout << "Starting radix sort benchmark on Device " << device_index << ": " << name << std::endl;
+
+    cl_context context = create_context(platform, device);
+    cl_command_queue queue = create_queue(context, device, device_index);
+
+    std::ostringstream report;
+    report << "Device " << device_index << " (" << name << ") LSD radix sort, " << RadixSortPlan::kRadixBits << "-bit digits:\n";
+    for (cl_uint key_bytes : {4u, 8u}) {
+        cl_uint n = radix_sort_key_count(device, key_bytes);
+        RadixSortPlan plan = create_radix_sort(context, device, device_index, n, key_bytes);
+
+        // Fresh keys for each repetition; only the sort itself is timed.
+        double total_s = 0.0;
+        cl_uint unsorted = 0;
+        for (int rep = 0; rep <= g_options.repeat; ++rep) {
+            enqueue_radix_keys(queue, plan, 0x9001u + rep);
+            check_cl_error(clFinish(queue), "clFinish(radix_init)");
+            auto start = std::chrono::steady_clock::now();
+            enqueue_radix_sort(queue, plan);
+            check_cl_error(clFinish(queue), "clFinish(radix sort)");
+            if (rep > 0) total_s += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            unsorted += count_unsorted_keys(queue, plan);
+        }
+        double seconds = total_s / g_options.repeat;
+        report << "  " << std::setw(2) << key_bytes * 8 << "-bit keys " << std::setw(11) << n << std::fixed
+               << std::setprecision(3) << std::setw(10) << seconds * 1e3 << " ms" << std::setprecision(1)
+               << std::setw(9) << n / (seconds * 1e6) << " Mkeys/s  "
+               << (unsorted == 0 ? "sorted" : std::to_string(unsorted) + " out-of-order pairs") << "\n";
+        release_radix_sort(plan);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(g_output_mutex);
+        std::cout << report.str() << std::flush;
+    }
+
+    clReleaseCommandQueue(queue);
+    clReleaseContext(context);
+}
+
+// Sustained load built from sorting: regenerate and sort 32-bit keys back to back and report
+// the rate every 10 seconds.
+void run_sort_load_on_device(cl_platform_id platform, cl_device_id device, int device_index) {
+    std::cout << "Starting sort load on Device " << device_index << ": " << get_device_name(device) << std::endl;
+
+    cl_context context = create_context(platform, device);
+    cl_command_queue queue = create_queue(context, device, device_index);
+    cl_uint n = radix_sort_key_count(device, 4);
+    RadixSortPlan plan = create_radix_sort(context, device, device_index, n, 4);
+
+    std::cout << "Device " << device_index << ": Entering continuous sort loop (" << n << " keys per sort)..." << std::endl;
+    LoopStats stats;
+    auto window_start = std::chrono::steady_clock::now();
+    size_t sorts = 0;
+    for (cl_uint iteration = 0; !stats.done(); ++iteration) {
+        auto launch = std::chrono::steady_clock::now();
+        enqueue_radix_keys(queue, plan, iteration);
+        enqueue_radix_sort(queue, plan);
+        cl_int err = clFinish(queue);
+        if (err != CL_SUCCESS) {
+            std::cerr << "Device " << device_index << ": clFinish failed: " << err << std::endl;
+            break;
+        }
+        stats.record(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - launch).count());
+        ++sorts;
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - window_start).count();
+        if (elapsed >= 10.0) {
+            cl_uint unsorted = count_unsorted_keys(queue, plan);
+            std::cout << "Device " << device_index << ": " << std::fixed << std::setprecision(1)
+                      << sorts * static_cast<double>(n) / (elapsed * 1e6) << " Mkeys/s"
+                      << (unsorted ? " (last sort had out-of-order keys!)" : "") << std::endl;
+            sorts = 0;
+            window_start = std::chrono::steady_clock::now();
+        }
+    }
+
+    std::cout << "Device " << device_index << ": Exited sort loop." << std::endl;
+    clFinish(queue);
+    print_loop_summary(device_index, get_device_name(device), stats, static_cast<double>(n), "keys");
+    release_radix_sort(plan);
+    clReleaseCommandQueue(queue);
+    clReleaseContext(context);
+}
+
+// Host copy of test_word() in hashKernelSource.
+cl_uint hash_test_word(cl_uint i) {
+    i ^= i >> 16; i *= 0x7FEB352Du; i ^= i >> 15; i *= 0x846CA68Bu; i ^= i >> 16;
+    return i;
+}
+
+cl_uint rotl32(cl_uint x, int n) { return (x << n) | (x >> (32 - n)); }
+cl_uint rotr32(cl_uint x, int n) { return (x >> n) | (x << (32 - n)); }
+
+// Reference SHA-256 (FIPS 180-4) of an arbitrary byte string.
+std::vector<cl_uint> host_sha256(const unsigned char* bytes, size_t length) {
+    static const cl_uint k[64] = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+    std::vector<cl_uint> h = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+    std::vector<unsigned char> padded(bytes, bytes + length);
+    padded.push_back(0x80);
+    while (padded.size() % 64 != 56) padded.push_back(0);
+    unsigned long long bits = static_cast<unsigned long long>(length) * 8;
+    for (int i = 7; i >= 0; --i) padded.push_back(static_cast<unsigned char>(bits >> (8 * i)));
+    for (size_t block = 0; block < padded.size(); block += 64) {
+        cl_uint w[64];
+        for (int t = 0; t < 16; ++t) {
+            const unsigned char* p = &padded[block + 4 * t];
+            w[t] = (cl_uint(p[0]) << 24) | (cl_uint(p[1]) << 16) | (cl_uint(p[2]) << 8) | cl_uint(p[3]);
+        }
+        for (int t = 16; t < 64; ++t) {
+            cl_uint s0 = rotr32(w[t - 15], 7) ^ rotr32(w[t - 15], 18) ^ (w[t - 15] >> 3);
+            cl_uint s1 = rotr32(w[t - 2], 17) ^ rotr32(w[t - 2], 19) ^ (w[t - 2] >> 10);
+            w[t] = w[t - 16] + s0 + w[t - 7] + s1;
+        }
+        cl_uint a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], hh = h[7];
+        for (int t = 0; t < 64; ++t) {
+            cl_uint t1 = hh + (rotr32(e, 6) ^ rotr32(e, 11) ^ rotr32(e, 25)) + ((e & f) ^ (~e & g)) + k[t] + w[t];
+            cl_uint t2 = (rotr32(a, 2) ^ rotr32(a, 13) ^ rotr32(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            hh = g; g = f; f = e; e = d + t1;
+            d = c; c = b; b = a; a = t1 + t2;
+        }
+        h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e; h[5] += f; h[6] += g; h[7] += hh;
+    }
+    return h;
+}
+
+// Reference XXH32 of an arbitrary byte string (little-endian host assumed).
+cl_uint host_xxh32(const unsigned char* bytes, size_t length, cl_uint seed) {
+    const cl_uint p1 = 0x9E3779B1u, p2 = 0x85EBCA77u, p3 = 0xC2B2AE3Du, p4 = 0x27D4EB2Fu, p5 = 0x165667B1u;
+    auto read32 = [](const unsigned char* p) { cl_uint v; std::memcpy(&v, p, 4); return v; };
+    auto xxh_round = [&](cl_uint acc, cl_uint input) { return rotl32(acc + input * p2, 13) * p1; };
+    size_t i = 0;
+    cl_uint h;
+    if (length >= 16) {
+        cl_uint v1 = seed + p1 + p2, v2 = seed + p2, v3 = seed, v4 = seed - p1;
+        for (; i + 16 <= length; i += 16) {
+            v1 = xxh_round(v1, read32(bytes + i));
+            v2 = xxh_round(v2, read32(bytes + i + 4));
+            v3 = xxh_round(v3, read32(bytes + i + 8));
+            v4 = xxh_round(v4, read32(bytes + i + 12));
+        }
+        h = rotl32(v1, 1) + rotl32(v2, 7) + rotl32(v3, 12) + rotl32(v4, 18);
+    } else {
+        h = seed + p5;
+    }
+    h += static_cast<cl_uint>(length);
+    for (; i + 4 <= length; i += 4) h = rotl32(h + read32(bytes + i) * p3, 17) * p4;
+    for (; i < length; ++i) h = rotl32(h + bytes[i] * p5, 11) * p1;
+    h ^= h >> 15; h *= p2;
+    h ^= h >> 13; h *= p3;
+    h ^= h >> 16;
+    return h;
+}
+
+void run_hash_on_device(cl_platform_id platform, cl_device_id device, int device_index) {
+    cl_int err;
+    std::string name = get_device_name(device);
+    std::cout << "Starting hashing benchmark on Device " << device_index << ": " << name << std::endl;
+
+    const cl_uint message_words = 256; // 1 KiB messages
+    const cl_uint xxh_seed = 0;
+    size_t message_bytes = message_words * sizeof(cl_uint);
+    cl_ulong max_alloc = 0;
+    clGetDeviceInfo(device, CL_DEVICE_MAX_MEM_ALLOC_SIZE, sizeof(max_alloc), &max_alloc, nullptr);
+    size_t bytes = std::min<size_t>(g_options.size_mb * 1024 * 1024, static_cast<size_t>(max_alloc));
+    size_t messages = std::max<size_t>(bytes / message_bytes / 256 * 256, 256);
+    size_t words = messages * message_words;
+
+    cl_context context = create_context(platform, device);
+    cl_command_queue queue = create_queue(context, device, device_index, CL_QUEUE_PROFILING_ENABLE);
+    cl_program program = build_program(context, device, device_index, hashKernelSource,
+                                       "-cl-std=CL1.2 -DMESSAGE_WORDS=" + std::to_string(message_words));
+
+    cl_mem data = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(cl_uint) * words, nullptr, &err);
+    check_cl_error(err, "clCreateBuffer(data)");
+    cl_mem digests = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(cl_uint) * 8 * messages, nullptr, &err);
+    check_cl_error(err, "clCreateBuffer(digests)");
+    cl_kernel init = clCreateKernel(program, "hash_init", &err);
+    check_cl_error(err, "clCreateKernel(hash_init)");
+    check_cl_error(clSetKernelArg(init, 0, sizeof(cl_mem), &data), "clSetKernelArg(data)");
+    check_cl_error(clEnqueueNDRangeKernel(queue, init, 1, nullptr, &words, nullptr, 0, nullptr, nullptr), "clEnqueueNDRangeKernel(hash_init)");
+    clReleaseKernel(init);
+
+    std::ostringstream report;
+    report << "Device " << device_index << " (" << name << ") hashing, " << messages << " messages of "
+           << message_bytes << " bytes:\n";
+
+    for (const char* kernel_name : {"sha256_messages", "xxh32_messages"}) {
+        bool sha = std::strcmp(kernel_name, "sha256_messages") == 0;
+        cl_uint digest_words = sha ? 8 : 1;
+        cl_kernel kernel = clCreateKernel(program, kernel_name, &err);
+        check_cl_error(err, "clCreateKernel(hash)");
+        check_cl_error(clSetKernelArg(kernel, 0, sizeof(cl_mem), &data), "clSetKernelArg(data)");
+        check_cl_error(clSetKernelArg(kernel, 1, sizeof(cl_mem), &digests), "clSetKernelArg(digests)");
+        if (!sha) check_cl_error(clSetKernelArg(kernel, 2, sizeof(cl_uint), &xxh_seed), "clSetKernelArg(xxh_seed)");
+        double ms = time_kernel_ms(queue, kernel, 1, &messages, nullptr, g_options.repeat);
+        clReleaseKernel(kernel);
+
+        // Recompute a spread of messages on the host from the same generator.
+        std::vector<cl_uint> device_digests(digest_words * messages);
+        check_cl_error(clEnqueueReadBuffer(queue, digests, CL_TRUE, 0, sizeof(cl_uint) * device_digests.size(),
+                                           device_digests.data(), 0, nullptr, nullptr),
+                       "clEnqueueReadBuffer(digests)");
+        bool ok = true;
+        std::vector<cl_uint> message(message_words);
+        for (size_t m = 0; m < messages && ok; m += messages / 64) {
+            for (cl_uint w = 0; w < message_words; ++w) message[w] = hash_test_word(static_cast<cl_uint>(m * message_words + w));
+            const unsigned char* message_bytes_ptr = reinterpret_cast<const unsigned char*>(message.data());
+            if (sha) {
+                std::vector<cl_uint> expected = host_sha256(message_bytes_ptr, message_bytes);
+                ok = std::equal(expected.begin(), expected.end(), device_digests.begin() + m * 8);
+            } else {
+                ok = host_xxh32(message_bytes_ptr, message_bytes, xxh_seed) == device_digests[m];
+            }
+        }
+        report << "  " << std::left << std::setw(8) << (sha ? "sha256" : "xxh32") << std::right << std::fixed
+               << std::setprecision(3) << std::setw(10) << ms << " ms" << std::setprecision(2)
+               << std::setw(10) << messages / (ms * 1e3) << " Mhash/s" << std::setw(9)
+               << static_cast<double>(messages) * message_bytes / (ms * 1e6) << " GB/s  " << (ok ? "ok" : "MISMATCH") << "\n";
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(g_output_mutex);
+        std::cout << report.str() << std::flush;
+    }
+
+    clReleaseMemObject(digests);
+    clReleaseMemObject(data);
+    clReleaseProgram(program);
+    clReleaseCommandQueue(queue);
+    clReleaseContext(context);
+}
+
+void run_divergence_on_device(cl_platform_id platform, cl_device_id device, int device_index) {
+    cl_int err;
+    std::string name = get_device_name(device);
+    std::cout << "Starting branch divergence benchmark on Device " << device_index << ": " << name << std::endl;
+
+    cl_uint compute_units = 0;
+    clGetDeviceInfo(device, CL_DEVICE_MAX_COMPUTE_UNITS, sizeof(compute_units), &compute_units, nullptr);
+    const size_t wg = 256;
+    size_t global = static_cast<size_t>(compute_units) * 32 * wg;
+    const cl_uint iterations = 512;
+    // Fraction of units on path A, out of 1024. The uniform ends (0 and 1024) are always measured:
+    // the efficiency of every other column is relative to them.
+    std::vector<cl_uint> thresholds = {0, 64, 256, 512, 1024};
+    if (g_options.divergence_pct) {
+        cl_uint threshold = static_cast<cl_uint>(g_options.divergence_pct * 1024 / 100);
+        thresholds = {0, 1024};
+        if (threshold > 0 && threshold < 1024) thresholds.insert(thresholds.begin() + 1, threshold);
+    }
+    std::vector<cl_uint> granularities = {1, 8, 16, 32, static_cast<cl_uint>(wg)};
+    if (g_options.divergence_granularity) granularities = {static_cast<cl_uint>(g_options.divergence_granularity)};
+
+    cl_context context = create_context(platform, device);
+    cl_command_queue queue = create_queue(context, device, device_index, CL_QUEUE_PROFILING_ENABLE);
+    cl_mem out = clCreateBuffer(context, CL_MEM_WRITE_ONLY, sizeof(cl_float) * global, nullptr, &err);
+    check_cl_error(err, "clCreateBuffer(out)");
+
+    std::ostringstream report;
+    report << "Device " << device_index << " (" << name << ") branch divergence, " << global << " work-items.\n"
+           << "  Efficiency = time expected from the uniform runs / measured time; 1.00 means no divergence cost.\n";
+
+    for (size_t sg_size : forceable_subgroup_sizes(device)) {
+        std::string options = "-cl-std=CL1.2";
+        if (sg_size) options += " -DSG_SIZE=" + std::to_string(sg_size);
+        cl_program program;
+        try {
+            program = build_program(context, device, device_index, divergenceKernelSource, options);
+        } catch (const std::runtime_error& e) {
+            report << "  simd " << sg_size << ": build failed: " << e.what() << "\n";
+            continue;
+        }
+        cl_kernel kernel = clCreateKernel(program, "divergence", &err);
+        check_cl_error(err, "clCreateKernel(divergence)");
+        size_t simd = 0;
+        clGetKernelWorkGroupInfo(kernel, device, CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE, sizeof(simd), &simd, nullptr);
+        check_cl_error(clSetKernelArg(kernel, 0, sizeof(cl_mem), &out), "clSetKernelArg(out)");
+        check_cl_error(clSetKernelArg(kernel, 3, sizeof(cl_uint), &iterations), "clSetKernelArg(iterations)");
+
+        report << "  simd " << (sg_size ? std::to_string(sg_size) : "auto") << " (preferred multiple " << simd << ")\n";
+        report << "    " << std::left << std::setw(12) << "granularity";
+        for (cl_uint t : thresholds) report << std::right << std::setw(9) << std::fixed << std::setprecision(1) << 100.0 * t / 1024 << "%";
+        report << "\n";
+
+        for (cl_uint granularity : granularities) {
+            check_cl_error(clSetKernelArg(kernel, 1, sizeof(cl_uint), &granularity), "clSetKernelArg(granularity)");
+            std::vector<double> ms;
+            for (cl_uint threshold : thresholds) {
+                check_cl_error(clSetKernelArg(kernel, 2, sizeof(cl_uint), &threshold), "clSetKernelArg(threshold)");
+                ms.push_back(time_kernel_ms(queue, kernel, 1, &global, &wg, g_options.repeat));
+            }
+            // Without divergence the time is the mix of the two uniform runs.
+            double path_b = ms.front(), path_a = ms.back();
+            report << "    " << std::left << std::setw(12)
+                   << (granularity == 1 ? "lane" : granularity == wg ? "work-group" : std::to_string(granularity) + " lanes");
+            for (size_t t = 0; t < ms.size(); ++t) {
+                double f = thresholds[t] / 1024.0;
+                double expected = f * path_a + (1.0 - f) * path_b;
+                report << std::right << std::setw(10) << std::setprecision(2) << expected / ms[t];
+            }
+            report << "\n";
+        }
+        clReleaseKernel(kernel);
+        clReleaseProgram(program);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(g_output_mutex);
+        std::cout << report.str() << std::flush;
+    }
+
+    clReleaseMemObject(out);
+    clReleaseCommandQueue(queue);
+    clReleaseContext(context);
+}
+
+// "results.json" -> "results-dev1.json", so every device thread gets its own export file.
+std::string per_device_output_path(const std::string& path, int device_index) {
+    size_t slash = path.find_last_of('/');
+    size_t dot = path.find_last_of('.');
+    std::string suffix = "-dev" + std::to_string(device_index);
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) return path + suffix;
+    return path.substr(0, dot) + suffix + path.substr(dot);
+}
+
+bool output_is_json(const std::string& path) {
+    return path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+}
+
+std::string json_escape(const std::string& value) {
+    std::string escaped;
+    for (char c : value) {
+        if (c == '"' || c == '\\') escaped += '\\';
+        escaped += c;
+    }
+    return escaped;
+}
+
+void run_roofline_on_device(cl_platform_id platform, cl_device_id device, int device_index) {
+    cl_int err;
+    std::string name = get_device_name(device);
+    std::cout << "Starting roofline sweep on Device " << device_index << ": " << name << std::endl;
+
+    cl_uint bits = pick_pow2_elements(device, 4 * sizeof(cl_float), 10);
+    size_t vectors = size_t(1) << bits;
+    size_t bytes_moved = vectors * 2 * 4 * sizeof(cl_float);
+
+    cl_context context = create_context(platform, device);
+    cl_command_queue queue = create_queue(context, device, device_index, CL_QUEUE_PROFILING_ENABLE);
+    cl_mem in = clCreateBuffer(context, CL_MEM_READ_ONLY, vectors * 4 * sizeof(cl_float), nullptr, &err);
+    check_cl_error(err, "clCreateBuffer(in)");
+    cl_mem out = clCreateBuffer(context, CL_MEM_WRITE_ONLY, vectors * 4 * sizeof(cl_float), nullptr, &err);
+    check_cl_error(err, "clCreateBuffer(out)");
+    float init_value = 0.5f;
+    check_cl_error(clEnqueueFillBuffer(queue, in, &init_value, sizeof(init_value), 0, vectors * 4 * sizeof(cl_float), 0, nullptr, nullptr),
+                   "clEnqueueFillBuffer(in)");
+
+    struct RooflinePoint {
+        int fmas;
+        double intensity;
+        double gflops;
+        double gbps;
+        double ms;
+    };
+    std::vector<RooflinePoint> points;
+    const cl_float a = 0.999f, b = 0.001f; // Keeps values bounded over long chains
+    for (int fmas : {0, 1, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024}) {
+        cl_program program = build_program(context, device, device_index, rooflineKernelSource,
+                                           "-cl-std=CL1.2 -DFMAS=" + std::to_string(fmas));
+        cl_kernel kernel = clCreateKernel(program, "roofline", &err);
+        check_cl_error(err, "clCreateKernel(roofline)");
+        check_cl_error(clSetKernelArg(kernel, 0, sizeof(cl_mem), &in), "clSetKernelArg(in)");
+        check_cl_error(clSetKernelArg(kernel, 1, sizeof(cl_mem), &out), "clSetKernelArg(out)");
+        check_cl_error(clSetKernelArg(kernel, 2, sizeof(cl_float), &a), "clSetKernelArg(a)");
+        check_cl_error(clSetKernelArg(kernel, 3, sizeof(cl_float), &b), "clSetKernelArg(b)");
+        double ms = time_kernel_ms(queue, kernel, 1, &vectors, nullptr, g_options.repeat);
+        double flops = 8.0 * fmas * vectors;
+        points.push_back({fmas, fmas / 4.0, flops / (ms * 1e6), bytes_moved / (ms * 1e6), ms});
+        clReleaseKernel(kernel);
+        clReleaseProgram(program);
+    }
+
+    // Empirical ceilings: the best bandwidth and the best compute rate seen anywhere in the sweep.
+    double bandwidth_ceiling = 0.0, compute_ceiling = 0.0;
+    for (const RooflinePoint& p : points) {
+        bandwidth_ceiling = std::max(bandwidth_ceiling, p.gbps);
+        compute_ceiling = std::max(compute_ceiling, p.gflops);
+    }
+    double ridge = compute_ceiling / bandwidth_ceiling;
+
+    std::ostringstream report;
+    report << "Device " << device_index << " (" << name << ") roofline, " << (bytes_moved >> 20) << " MB moved per launch:\n";
+    report << "  " << std::right << std::setw(10) << "flop/byte" << std::setw(12) << "GFLOPS" << std::setw(10) << "GB/s" << "\n";
+    for (const RooflinePoint& p : points) {
+        report << "  " << std::fixed << std::setprecision(2) << std::setw(10) << p.intensity
+               << std::setprecision(1) << std::setw(12) << p.gflops << std::setw(10) << p.gbps << "\n";
+    }
+    report << "  bandwidth ceiling " << bandwidth_ceiling << " GB/s, compute ceiling " << compute_ceiling
+           << " GFLOPS, ridge point " << std::setprecision(2) << ridge << " flop/byte\n";
+
+    if (!g_options.output.empty()) {
+        std::string path = per_device_output_path(g_options.output, device_index);
+        std::ofstream file(path);
+        if (!file) throw std::runtime_error("cannot open " + path + " for writing");
+        file << std::setprecision(6);
+        if (output_is_json(path)) {
+            file << "{\n  \"device\": " << device_index << ",\n  \"name\": \"" << json_escape(name) << "\",\n"
+                 << "  \"bandwidth_gbps\": " << bandwidth_ceiling << ",\n  \"compute_gflops\": " << compute_ceiling << ",\n"
+                 << "  \"ridge_flops_per_byte\": " << ridge << ",\n  \"points\": [\n";
+            for (size_t i = 0; i < points.size(); ++i) {
+                const RooflinePoint& p = points[i];
+                file << "    {\"flops_per_byte\": " << p.intensity << ", \"gflops\": " << p.gflops
+                     << ", \"gbps\": " << p.gbps << ", \"time_ms\": " << p.ms << "}" << (i + 1 < points.size() ? "," : "") << "\n";
+            }
+            file << "  ]\n}\n";
+        } else {
+            file << "# device " << device_index << ": " << name << "\n"
+                 << "# bandwidth_gbps=" << bandwidth_ceiling << " compute_gflops=" << compute_ceiling
+                 << " ridge_flops_per_byte=" << ridge << "\n"
+                 << "flops_per_byte,gflops,gbps,time_ms\n";
+            for (const RooflinePoint& p : points) file << p.intensity << "," << p.gflops << "," << p.gbps << "," << p.ms << "\n";
+        }
+        report << "  roofline data written to " << path << "\n";
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(g_output_mutex);
+        std::cout << report.str() << std::flush;
+    }
+
+    clReleaseMemObject(out);
+    clReleaseMemObject(in);
+    clReleaseCommandQueue(queue);
+    clReleaseContext(context);
+}
+
+// Generates a kernel that keeps `live` floats in flight across a loop (one dependent FMA and
+// multiply per value per iteration, each feeding the next) plus a private array of `private_floats`
+// indexed dynamically, which the compiler has to place in private memory.
+std::string generate_pressure_kernel(int live, int private_floats) {
+    std::ostringstream src;
+    src << "__kernel void pressure(__global const float* in, __global float* out, const uint iterations) {\n"
+        << "    uint gid = get_global_id(0);\n"
+        << "    float seed = in[gid];\n";
+    for (int j = 0; j < live; ++j) src << "    float a" << j << " = seed + " << j << ".0f;\n";
+    if (private_floats > 0) {
+        src << "    float priv[" << private_floats << "];\n"
+            << "    for (int j = 0; j < " << private_floats << "; ++j) priv[j] = seed * (float)j;\n";
+    }
+    src << "    for (uint i = 0; i < iterations; ++i) {\n";
+    for (int j = 0; j < live; ++j) {
+        src << "        a" << j << " = fma(a" << j << ", 0.999f, a" << (j + 1) % live << " * 0.001f);\n";
+    }
+    if (private_floats > 0) src << "        priv[(gid + i) % " << private_floats << "] += a0;\n";
+    src << "    }\n    float sum = 0.0f;\n";
+    for (int j = 0; j < live; ++j) src << "    sum += a" << j << ";\n";
+    if (private_floats > 0) src << "    for (int j = 0; j < " << private_floats << "; ++j) sum += priv[j];\n";
+    src << "    out[gid] = sum;\n}\n";
+    return src.str();
+}
+
+void run_pressure_on_device(cl_platform_id platform, cl_device_id device, int device_index) {
+    cl_int err;
+    std::string name = get_device_name(device);
+    std::cout << "Starting register pressure sweep on Device " << device_index << ": " << name << std::endl;
+
+    cl_uint compute_units = 0;
+    clGetDeviceInfo(device, CL_DEVICE_MAX_COMPUTE_UNITS, sizeof(compute_units), &compute_units, nullptr);
+    size_t global = static_cast<size_t>(compute_units) * 16 * 256;
+    const cl_uint iterations = 256;
+    bool intel_spill_query = device_has_extension(device, "cl_intel_required_subgroup_size");
+
+    cl_context context = create_context(platform, device);
+    cl_command_queue queue = create_queue(context, device, device_index, CL_QUEUE_PROFILING_ENABLE);
+    cl_mem in = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_float) * global, nullptr, &err);
+    check_cl_error(err, "clCreateBuffer(in)");
+    cl_mem out = clCreateBuffer(context, CL_MEM_WRITE_ONLY, sizeof(cl_float) * global, nullptr, &err);
+    check_cl_error(err, "clCreateBuffer(out)");
+    float init_value = 0.5f;
+    check_cl_error(clEnqueueFillBuffer(queue, in, &init_value, sizeof(init_value), 0, sizeof(cl_float) * global, 0, nullptr, nullptr),
+                   "clEnqueueFillBuffer(in)");
+
+    std::ostringstream report;
+    report << "Device " << device_index << " (" << name << ") register pressure, " << global << " work-items:\n";
+    report << "  " << std::right << std::setw(6) << "live" << std::setw(8) << "priv" << std::setw(10) << "private B"
+           << std::setw(9) << "local B" << std::setw(9) << "spill B" << std::setw(8) << "max wg" << std::setw(6) << "simd"
+           << std::setw(10) << "GFLOPS" << "\n";
+
+    struct PressurePoint {
+        int live;
+        int private_floats;
+    };
+    std::vector<PressurePoint> sweep;
+    for (int live : {8, 16, 32, 48, 64, 96, 128, 192, 256}) sweep.push_back({live, 0});
+    for (int private_floats : {16, 64, 256, 1024}) sweep.push_back({16, private_floats});
+
+    double best_gflops = 0.0;
+    for (const PressurePoint& point : sweep) {
+        // Reset the cliff reference when the sweep switches from live values to private arrays
+        if (point.private_floats == 16) best_gflops = 0.0;
+        std::string source = generate_pressure_kernel(point.live, point.private_floats);
+        cl_program program = build_program(context, device, device_index, source.c_str(), "-cl-std=CL1.2");
+        cl_kernel kernel = clCreateKernel(program, "pressure", &err);
+        check_cl_error(err, "clCreateKernel(pressure)");
+
+        cl_ulong private_mem = 0, local_mem = 0, spill_mem = 0;
+        size_t max_wg = 0, simd = 0;
+        clGetKernelWorkGroupInfo(kernel, device, CL_KERNEL_PRIVATE_MEM_SIZE, sizeof(private_mem), &private_mem, nullptr);
+        clGetKernelWorkGroupInfo(kernel, device, CL_KERNEL_LOCAL_MEM_SIZE, sizeof(local_mem), &local_mem, nullptr);
+        clGetKernelWorkGroupInfo(kernel, device, CL_KERNEL_WORK_GROUP_SIZE, sizeof(max_wg), &max_wg, nullptr);
+        clGetKernelWorkGroupInfo(kernel, device, CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE, sizeof(simd), &simd, nullptr);
+        bool spill_known = intel_spill_query &&
+            clGetKernelWorkGroupInfo(kernel, device, CL_KERNEL_SPILL_MEM_SIZE_INTEL, sizeof(spill_mem), &spill_mem, nullptr) == CL_SUCCESS;
+        // Some compilers only mention spilling in the (successful) build log
+        std::string log = get_build_log(program, device);
+        bool log_mentions_spill = log.find("spill") != std::string::npos || log.find("Spill") != std::string::npos;
+
+        check_cl_error(clSetKernelArg(kernel, 0, sizeof(cl_mem), &in), "clSetKernelArg(in)");
+        check_cl_error(clSetKernelArg(kernel, 1, sizeof(cl_mem), &out), "clSetKernelArg(out)");
+        check_cl_error(clSetKernelArg(kernel, 2, sizeof(cl_uint), &iterations), "clSetKernelArg(iterations)");
+        double ms = time_kernel_ms(queue, kernel, 1, &global, nullptr, g_options.repeat);
+        // Each live value costs an FMA plus the multiply feeding its addend: 3 flops per iteration.
+        double gflops = 3.0 * point.live * iterations * static_cast<double>(global) / (ms * 1e6);
+        bool cliff = best_gflops > 0.0 && gflops < 0.75 * best_gflops;
+        best_gflops = std::max(best_gflops, gflops);
+
+        report << "  " << std::setw(6) << point.live << std::setw(8) << point.private_floats << std::setw(10) << private_mem
+               << std::setw(9) << local_mem << std::setw(9) << (spill_known ? std::to_string(spill_mem) : std::string("n/a"))
+               << std::setw(8) << max_wg << std::setw(6) << simd << std::fixed << std::setprecision(1) << std::setw(10) << gflops
+               << (log_mentions_spill ? "  build log reports spills" : "") << (cliff ? "  <- cliff" : "") << "\n";
+        clReleaseKernel(kernel);
+        clReleaseProgram(program);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(g_output_mutex);
+        std::cout << report.str() << std::flush;
+    }
+
+    clReleaseMemObject(out);
+    clReleaseMemObject(in);
+    clReleaseCommandQueue(queue);
+    clReleaseContext(context);
+}
+
+bool device_supports_pipes(cl_device_id device) {
+    int version = device_cl_version(device);
+    if (version < 20) return false;
+    if (version >= 30) {
+        cl_bool pipe_support = CL_FALSE;
+        if (clGetDeviceInfo(device, CL_DEVICE_PIPE_SUPPORT, sizeof(pipe_support), &pipe_support, nullptr) != CL_SUCCESS || !pipe_support) {
+            return false;
+        }
+    }
+    cl_uint max_pipe_args = 0;
+    clGetDeviceInfo(device, CL_DEVICE_MAX_PIPE_ARGS, sizeof(max_pipe_args), &max_pipe_args, nullptr);
+    return max_pipe_args > 0;
+}
+
+void run_pipes_on_device(cl_platform_id platform, cl_device_id device, int device_index) {
+    cl_int err;
+    std::string name = get_device_name(device);
+    std::cout << "Starting pipe producer/consumer benchmark on Device " << device_index << ": " << name << std::endl;
+
+    if (!device_supports_pipes(device)) {
+        std::lock_guard<std::mutex> lock(g_output_mutex);
+        std::cout << "Device " << device_index << " (" << name << "): pipes not supported, skipping." << std::endl;
+        return;
+    }
+    cl_uint max_packet_size = 0;
+    clGetDeviceInfo(device, CL_DEVICE_PIPE_MAX_PACKET_SIZE, sizeof(max_packet_size), &max_packet_size, nullptr);
+    cl_uint compute_units = 0;
+    clGetDeviceInfo(device, CL_DEVICE_MAX_COMPUTE_UNITS, sizeof(compute_units), &compute_units, nullptr);
+
+    // Small NDRanges so producer and consumer can be resident on the device at the same time.
+    size_t items = static_cast<size_t>(compute_units) * 64;
+    const cl_uint packets_per_item = 256;
+    double packets = static_cast<double>(items) * packets_per_item;
+
+    std::vector<size_t> packet_sizes = {4, 16, 64, 256};
+    std::vector<size_t> depths = {64, 1024, 16384};
+    if (g_options.packet_bytes) packet_sizes = {g_options.packet_bytes};
+    if (g_options.pipe_depth) depths = {g_options.pipe_depth};
+
+    cl_context context = create_context(platform, device);
+    cl_command_queue producer_queue = create_queue(context, device, device_index);
+    cl_command_queue consumer_queue = create_queue(context, device, device_index);
+    cl_mem checksum = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(cl_uint), nullptr, &err);
+    check_cl_error(err, "clCreateBuffer(checksum)");
+    cl_mem producer_stalls = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(cl_uint), nullptr, &err);
+    check_cl_error(err, "clCreateBuffer(producer_stalls)");
+    cl_mem consumer_stalls = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(cl_uint), nullptr, &err);
+    check_cl_error(err, "clCreateBuffer(consumer_stalls)");
+
+    // Sum of all sequence numbers, modulo 2^32 like the device atomics
+    cl_uint expected_checksum = 0;
+    for (cl_uint seq = 0; seq < items * packets_per_item; ++seq) expected_checksum += seq;
+
+    std::ostringstream report;
+    report << "Device " << device_index << " (" << name << ") pipes, " << items << " producers and consumers x "
+           << packets_per_item << " packets, max packet " << max_packet_size << " bytes:\n";
+    report << "  " << std::right << std::setw(8) << "bytes" << std::setw(8) << "depth" << std::setw(12) << "Mpacket/s"
+           << std::setw(10) << "GB/s" << "  result\n";
+
+    for (size_t packet_bytes : packet_sizes) {
+        if (packet_bytes > max_packet_size) {
+            report << "  " << std::setw(8) << packet_bytes << "  exceeds CL_DEVICE_PIPE_MAX_PACKET_SIZE, skipped\n";
+            continue;
+        }
+        cl_program program = build_program(context, device, device_index, pipeKernelSource,
+                                           cl_std_option(device) + " -DPACKET_WORDS=" + std::to_string(packet_bytes / 4));
+        cl_kernel producer = clCreateKernel(program, "pipe_producer", &err);
+        check_cl_error(err, "clCreateKernel(pipe_producer)");
+        cl_kernel consumer = clCreateKernel(program, "pipe_consumer", &err);
+        check_cl_error(err, "clCreateKernel(pipe_consumer)");
+
+        for (size_t depth : depths) {
+            cl_mem pipe = clCreatePipe(context, CL_MEM_READ_WRITE, static_cast<cl_uint>(packet_bytes), static_cast<cl_uint>(depth), nullptr, &err);
+            check_cl_error(err, "clCreatePipe");
+            check_cl_error(clSetKernelArg(producer, 0, sizeof(cl_mem), &pipe), "clSetKernelArg(pipe)");
+            check_cl_error(clSetKernelArg(producer, 1, sizeof(cl_uint), &packets_per_item), "clSetKernelArg(packets_per_item)");
+            check_cl_error(clSetKernelArg(producer, 2, sizeof(cl_mem), &producer_stalls), "clSetKernelArg(producer_stalls)");
+            check_cl_error(clSetKernelArg(consumer, 0, sizeof(cl_mem), &pipe), "clSetKernelArg(pipe)");
+            check_cl_error(clSetKernelArg(consumer, 1, sizeof(cl_uint), &packets_per_item), "clSetKernelArg(packets_per_item)");
+            check_cl_error(clSetKernelArg(consumer, 2, sizeof(cl_mem), &checksum), "clSetKernelArg(checksum)");
+            check_cl_error(clSetKernelArg(consumer, 3, sizeof(cl_mem), &consumer_stalls), "clSetKernelArg(consumer_stalls)");
+
+            double total_s = 0.0;
+            cl_uint stalls = 0;
+            bool checksum_ok = true;
+            for (int rep = 0; rep <= g_options.repeat; ++rep) {
+                cl_uint zero = 0;
+                for (cl_mem counter : {checksum, producer_stalls, consumer_stalls}) {
+                    check_cl_error(clEnqueueWriteBuffer(producer_queue, counter, CL_TRUE, 0, sizeof(zero), &zero, 0, nullptr, nullptr),
+                                   "clEnqueueWriteBuffer(counter)");
+                }
+                // Consumer first, so it is already waiting when the first packets land.
+                auto start = std::chrono::steady_clock::now();
+                check_cl_error(clEnqueueNDRangeKernel(consumer_queue, consumer, 1, nullptr, &items, nullptr, 0, nullptr, nullptr),
+                               "clEnqueueNDRangeKernel(pipe_consumer)");
+                check_cl_error(clFlush(consumer_queue), "clFlush(consumer)");
+                check_cl_error(clEnqueueNDRangeKernel(producer_queue, producer, 1, nullptr, &items, nullptr, 0, nullptr, nullptr),
+                               "clEnqueueNDRangeKernel(pipe_producer)");
+                check_cl_error(clFlush(producer_queue), "clFlush(producer)");
+                check_cl_error(clFinish(producer_queue), "clFinish(producer)");
+                check_cl_error(clFinish(consumer_queue), "clFinish(consumer)");
+                if (rep > 0) total_s += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+                cl_uint values[3] = {0, 0, 0};
+                check_cl_error(clEnqueueReadBuffer(producer_queue, checksum, CL_TRUE, 0, sizeof(cl_uint), &values[0], 0, nullptr, nullptr),
+                               "clEnqueueReadBuffer(checksum)");
+                check_cl_error(clEnqueueReadBuffer(producer_queue, producer_stalls, CL_TRUE, 0, sizeof(cl_uint), &values[1], 0, nullptr, nullptr),
+                               "clEnqueueReadBuffer(producer_stalls)");
+                check_cl_error(clEnqueueReadBuffer(producer_queue, consumer_stalls, CL_TRUE, 0, sizeof(cl_uint), &values[2], 0, nullptr, nullptr),
+                               "clEnqueueReadBuffer(consumer_stalls)");
+                stalls += values[1] + values[2];
+                checksum_ok = checksum_ok && values[0] == expected_checksum;
+            }
+            clReleaseMemObject(pipe);
+
+            double seconds = total_s / g_options.repeat;
+            report << "  " << std::setw(8) << packet_bytes << std::setw(8) << depth << std::fixed << std::setprecision(2)
+                   << std::setw(12) << packets / (seconds * 1e6) << std::setw(10) << packets * packet_bytes / (seconds * 1e9) << "  "
+                   << (stalls ? std::to_string(stalls) + " stalled work-items (kernels not concurrent?)"
+                              : checksum_ok ? "ok" : "CHECKSUM MISMATCH") << "\n";
+        }
+        clReleaseKernel(consumer);
+        clReleaseKernel(producer);
+        clReleaseProgram(program);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(g_output_mutex);
+        std::cout << report.str() << std::flush;
+    }
+
+    clReleaseMemObject(consumer_stalls);
+    clReleaseMemObject(producer_stalls);
+    clReleaseMemObject(checksum);
+    clReleaseCommandQueue(consumer_queue);
+    clReleaseCommandQueue(producer_queue);
+    clReleaseContext(context);
+}
+
+void run_memtest_on_device(cl_platform_id platform, cl_device_id device, int device_index) {
+    cl_int err;
+    std::string name = get_device_name(device);
+    std::cout << "Starting VRAM integrity test on Device " << device_index << ": " << name << std::endl;
+
+    cl_ulong global_mem = 0, max_alloc = 0;
+    cl_bool unified = CL_FALSE;
+    clGetDeviceInfo(device, CL_DEVICE_GLOBAL_MEM_SIZE, sizeof(global_mem), &global_mem, nullptr);
+    clGetDeviceInfo(device, CL_DEVICE_MAX_MEM_ALLOC_SIZE, sizeof(max_alloc), &max_alloc, nullptr);
+    clGetDeviceInfo(device, CL_DEVICE_HOST_UNIFIED_MEMORY, sizeof(unified), &unified, nullptr);
+    // Integrated GPUs report system RAM as global memory; test a quarter of it rather than most.
+    const cl_ulong mb = 1024 * 1024;
+    cl_ulong target = unified ? global_mem / 4 : global_mem / 10 * 9;
+    cl_ulong chunk_limit = std::min<cl_ulong>(max_alloc, 1024 * mb) / mb * mb;
+    const cl_uint max_logged = 16;
+
+    cl_context context = create_context(platform, device);
+    cl_command_queue queue = create_queue(context, device, device_index, CL_QUEUE_PROFILING_ENABLE);
+    cl_program program = build_program(context, device, device_index, memtestKernelSource,
+                                       "-cl-std=CL1.2 -DMAX_LOGGED=" + std::to_string(max_logged));
+    cl_kernel fill = clCreateKernel(program, "memtest_fill", &err);
+    check_cl_error(err, "clCreateKernel(memtest_fill)");
+    cl_kernel check = clCreateKernel(program, "memtest_check", &err);
+    check_cl_error(err, "clCreateKernel(memtest_check)");
+    cl_mem error_count = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(cl_uint), nullptr, &err);
+    check_cl_error(err, "clCreateBuffer(error_count)");
+    cl_mem error_log = clCreateBuffer(context, CL_MEM_WRITE_ONLY, sizeof(cl_uint4) * max_logged, nullptr, &err);
+    check_cl_error(err, "clCreateBuffer(error_log)");
+    check_cl_error(clSetKernelArg(check, 6, sizeof(cl_mem), &error_count), "clSetKernelArg(error_count)");
+    check_cl_error(clSetKernelArg(check, 7, sizeof(cl_mem), &error_log), "clSetKernelArg(error_log)");
+
+    // Allocate in chunks up to the target; stop early if the driver refuses.
+    std::vector<cl_mem> chunks;
+    std::vector<cl_ulong> chunk_bytes;
+    cl_ulong allocated = 0;
+    while (target - allocated >= mb) {
+        cl_ulong bytes = std::min(chunk_limit, (target - allocated) / mb * mb);
+        cl_mem chunk = clCreateBuffer(context, CL_MEM_READ_WRITE, bytes, nullptr, &err);
+        if (err != CL_SUCCESS) break;
+        chunks.push_back(chunk);
+        chunk_bytes.push_back(bytes);
+        allocated += bytes;
+    }
+    if (chunks.empty()) throw std::runtime_error("no memory could be allocated for the test");
+
+    // Runs `kernel` over every chunk and returns the summed device time in ms.
+    auto run_pass = [&](cl_kernel kernel) {
+        std::vector<cl_event> events(chunks.size());
+        cl_ulong base_vec = 0;
+        for (size_t c = 0; c < chunks.size(); ++c) {
+            size_t vecs = chunk_bytes[c] / sizeof(cl_uint4);
+            size_t local = 256;
+            check_cl_error(clSetKernelArg(kernel, 0, sizeof(cl_mem), &chunks[c]), "clSetKernelArg(chunks)");
+            check_cl_error(clSetKernelArg(kernel, 1, sizeof(cl_ulong), &base_vec), "clSetKernelArg(base_vec)");
+            check_cl_error(clEnqueueNDRangeKernel(queue, kernel, 1, nullptr, &vecs, &local, 0, nullptr, &events[c]),
+                           "clEnqueueNDRangeKernel(memtest)");
+            base_vec += vecs;
+        }
+        check_cl_error(clFinish(queue), "clFinish(memtest)");
+        double ms = 0.0;
+        for (cl_event event : events) {
+            cl_ulong start = 0, end = 0;
+            clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_START, sizeof(start), &start, nullptr);
+            clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_END, sizeof(end), &end, nullptr);
+            clReleaseEvent(event);
+            ms += (end - start) * 1e-6;
+        }
+        return ms;
+    };
+
+    struct PatternPass { const char* label; cl_uint kind; };
+    const PatternPass patterns[] = {{"walking ones", 0}, {"walking zeros", 1}, {"philox", 2}};
+    const char* steps[] = {"fill", "check+invert", "check inverse"};
+    double step_ms[3] = {0.0, 0.0, 0.0};
+    cl_ulong total_errors = 0;
+    std::vector<std::string> logged;
+
+    std::ostringstream report;
+    report << "Device " << device_index << " (" << name << ") memtest over " << allocated / mb << " MB in " << chunks.size()
+           << " buffers (" << std::fixed << std::setprecision(1) << 100.0 * allocated / global_mem << "% of global memory"
+           << (unified ? ", unified memory capped at 25%" : "") << "), " << g_options.repeat << " rounds:\n";
+
+    for (int round = 0; round < g_options.repeat; ++round) {
+        for (const PatternPass& pattern : patterns) {
+            // Walking patterns move one bit per round; Philox draws a fresh stream.
+            cl_uint seed = static_cast<cl_uint>(round);
+            cl_uint zero = 0, one = 1;
+            check_cl_error(clEnqueueWriteBuffer(queue, error_count, CL_TRUE, 0, sizeof(zero), &zero, 0, nullptr, nullptr),
+                           "clEnqueueWriteBuffer(error_count)");
+            check_cl_error(clSetKernelArg(fill, 2, sizeof(cl_uint), &pattern.kind), "clSetKernelArg(kind)");
+            check_cl_error(clSetKernelArg(fill, 3, sizeof(cl_uint), &seed), "clSetKernelArg(seed)");
+            step_ms[0] += run_pass(fill);
+            check_cl_error(clSetKernelArg(check, 2, sizeof(cl_uint), &pattern.kind), "clSetKernelArg(kind)");
+            check_cl_error(clSetKernelArg(check, 3, sizeof(cl_uint), &seed), "clSetKernelArg(seed)");
+            check_cl_error(clSetKernelArg(check, 4, sizeof(cl_uint), &zero), "clSetKernelArg(zero)");
+            check_cl_error(clSetKernelArg(check, 5, sizeof(cl_uint), &one), "clSetKernelArg(one)");
+            step_ms[1] += run_pass(check);
+            check_cl_error(clSetKernelArg(check, 4, sizeof(cl_uint), &one), "clSetKernelArg(one)");
+            check_cl_error(clSetKernelArg(check, 5, sizeof(cl_uint), &zero), "clSetKernelArg(zero)");
+            step_ms[2] += run_pass(check);
+
+            cl_uint errors = 0;
+            check_cl_error(clEnqueueReadBuffer(queue, error_count, CL_TRUE, 0, sizeof(errors), &errors, 0, nullptr, nullptr),
+                           "clEnqueueReadBuffer(error_count)");
+            if (errors) {
+                std::vector<cl_uint4> entries(std::min(errors, max_logged));
+                check_cl_error(clEnqueueReadBuffer(queue, error_log, CL_TRUE, 0, sizeof(cl_uint4) * entries.size(), entries.data(),
+                                                   0, nullptr, nullptr),
+                               "clEnqueueReadBuffer(error_log)");
+                for (const cl_uint4& e : entries) {
+                    if (logged.size() >= max_logged) break;
+                    cl_ulong offset = ((static_cast<cl_ulong>(e.s[1]) << 32) | e.s[0]) * sizeof(cl_uint);
+                    char line[128];
+                    std::snprintf(line, sizeof(line), "round %d %-13s offset 0x%011llx expected 0x%08x read 0x%08x",
+                                  round, pattern.label, static_cast<unsigned long long>(offset), e.s[2], e.s[3]);
+                    logged.push_back(line);
+                }
+            }
+            total_errors += errors;
+        }
+    }
+
+    // Bytes moved per step: fill writes, check+invert reads and writes, the final check reads.
+    double passes = static_cast<double>(g_options.repeat) * 3;
+    const double traffic[3] = {1.0, 2.0, 1.0};
+    for (int s = 0; s < 3; ++s) {
+        report << "  " << std::left << std::setw(14) << steps[s] << std::right << std::setw(10) << std::setprecision(2)
+               << traffic[s] * allocated * passes / (step_ms[s] * 1e6) << " GB/s\n";
+    }
+    report << "  errors: " << total_errors << (total_errors ? "  ** MEMORY ERRORS DETECTED **" : "") << "\n";
+    for (const std::string& line : logged) report << "    " << line << "\n";
+    if (total_errors > logged.size()) report << "    (" << total_errors - logged.size() << " more not logged)\n";
+
+    {
+        std::lock_guard<std::mutex> lock(g_output_mutex);
+        std::cout << report.str() << std::flush;
+    }
+
+    for (cl_mem chunk : chunks) clReleaseMemObject(chunk);
+    clReleaseMemObject(error_log);
+    clReleaseMemObject(error_count);
+    clReleaseKernel(check);
+    clReleaseKernel(fill);
+    clReleaseProgram(program);
+    clReleaseCommandQueue(queue);
+    clReleaseContext(context);
+}
+
+// Value at fraction `p` of an ascending-sorted sample.
+double sorted_percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) return 0.0;
+    return sorted[static_cast<size_t>(p * (sorted.size() - 1) + 0.5)];
+}
+
+struct ChurnSamples {
+    std::vector<double> create_us, touch_us, release_us; // In issue order
+    size_t failures = 0;
+};
+
+// One allocation churn worker. Keeps a bounded live set, randomly releasing entries and
+// allocating replacements, and times each create, first touch (a 4-byte fill, which forces
+// drivers with lazy backing to commit memory) and release.
+void churn_worker(cl_context context, cl_device_id device, int device_index, bool svm, int distribution, size_t ops,
+                  cl_ulong live_budget, cl_ulong max_alloc, unsigned seed, ChurnSamples& samples) {
+    cl_int err;
+    cl_command_queue queue = create_queue(context, device, device_index);
+    std::mt19937 rng(seed);
+    struct Allocation { cl_mem buffer; void* pointer; size_t bytes; };
+    std::vector<Allocation> live;
+    cl_ulong live_bytes = 0;
+    const size_t max_live = 64;
+    const cl_uint zero = 0;
+
+    auto micros_since = [](std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    };
+    auto release = [&](size_t index, bool timed) {
+        Allocation victim = live[index];
+        live[index] = live.back();
+        live.pop_back();
+        live_bytes -= victim.bytes;
+        auto start = std::chrono::steady_clock::now();
+        if (svm) clSVMFree(context, victim.pointer);
+        else clReleaseMemObject(victim.buffer);
+        if (timed) samples.release_us.push_back(micros_since(start));
+    };
+
+    for (size_t op = 0; op < ops; ++op) {
+        // small: 4-64 KB, mixed: 4 KB-64 MB log-uniform, large: 16-256 MB
+        size_t bytes = distribution == 0 ? size_t(4096) << (rng() % 5)
+                     : distribution == 1 ? size_t(4096) << (rng() % 15)
+                                         : size_t(16) * 1024 * 1024 << (rng() % 5);
+        bytes = static_cast<size_t>(std::min<cl_ulong>(bytes, max_alloc));
+        if (!live.empty() && rng() % 2 == 0) release(rng() % live.size(), true);
+        while (!live.empty() && (live.size() >= max_live || live_bytes + bytes > live_budget)) release(rng() % live.size(), true);
+
+        Allocation allocation = {nullptr, nullptr, bytes};
+        auto start = std::chrono::steady_clock::now();
+        if (svm) {
+            allocation.pointer = clSVMAlloc(context, CL_MEM_READ_WRITE, bytes, 0);
+            err = allocation.pointer ? CL_SUCCESS : CL_MEM_OBJECT_ALLOCATION_FAILURE;
+        } else {
+            allocation.buffer = clCreateBuffer(context, CL_MEM_READ_WRITE, bytes, nullptr, &err);
+        }
+        double create_us = micros_since(start);
+        if (err != CL_SUCCESS) {
+            ++samples.failures;
+            continue;
+        }
+        start = std::chrono::steady_clock::now();
+        err = svm ? clEnqueueSVMMemFill(queue, allocation.pointer, &zero, sizeof(zero), sizeof(zero), 0, nullptr, nullptr)
+                  : clEnqueueFillBuffer(queue, allocation.buffer, &zero, sizeof(zero), 0, sizeof(zero), 0, nullptr, nullptr);
+        if (err == CL_SUCCESS) err = clFinish(queue);
+        samples.create_us.push_back(create_us);
+        if (err != CL_SUCCESS) {
+            ++samples.failures; // Creation was lazy and the backing store could not be committed
+        } else {
+            samples.touch_us.push_back(micros_since(start));
+        }
+        live.push_back(allocation);
+        live_bytes += bytes;
+    }
+    while (!live.empty()) release(live.size() - 1, false);
+    clReleaseCommandQueue(queue);
+}
+
+// Largest single buffer (in 1/8 steps of the allocation limit) that can be created and used.
+cl_ulong largest_usable_buffer(cl_context context, cl_command_queue queue, cl_ulong max_alloc) {
+    const cl_uint zero = 0;
+    for (int eighths = 8; eighths > 0; --eighths) {
+        cl_ulong bytes = max_alloc / 8 * eighths / sizeof(cl_uint) * sizeof(cl_uint);
+        cl_int err;
+        cl_mem buffer = clCreateBuffer(context, CL_MEM_READ_WRITE, bytes, nullptr, &err);
+        if (err != CL_SUCCESS) continue;
+        err = clEnqueueFillBuffer(queue, buffer, &zero, sizeof(zero), bytes - sizeof(zero), sizeof(zero), 0, nullptr, nullptr);
+        if (err == CL_SUCCESS) err = clFinish(queue);
+        clReleaseMemObject(buffer);
+        if (err == CL_SUCCESS) return bytes;
+    }
+    return 0;
+}
+
+void run_alloc_churn_on_device(cl_platform_id platform, cl_device_id device, int device_index) {
+    cl_int err;
+    std::string name = get_device_name(device);
+    std::cout << "Starting allocation churn benchmark on Device " << device_index << ": " << name << std::endl;
+
+    cl_ulong global_mem = 0, max_alloc = 0;
+    clGetDeviceInfo(device, CL_DEVICE_GLOBAL_MEM_SIZE, sizeof(global_mem), &global_mem, nullptr);
+    clGetDeviceInfo(device, CL_DEVICE_MAX_MEM_ALLOC_SIZE, sizeof(max_alloc), &max_alloc, nullptr);
+    bool svm_supported = false;
+    if (device_cl_version(device) >= 20) {
+        cl_device_svm_capabilities svm_caps = 0;
+        clGetDeviceInfo(device, CL_DEVICE_SVM_CAPABILITIES, sizeof(svm_caps), &svm_caps, nullptr);
+        svm_supported = (svm_caps & CL_DEVICE_SVM_COARSE_GRAIN_BUFFER) != 0;
+    }
+    unsigned worker_count = std::max(2u, std::min(4u, std::thread::hardware_concurrency()));
+
+    cl_context context = create_context(platform, device);
+    cl_command_queue queue = create_queue(context, device, device_index);
+
+    // Background load for the "busy" rows: load_kernel relaunched on its own queue until told to stop.
+    cl_program load_program = build_program(context, device, device_index, kernelSource, "-cl-std=CL1.2");
+    cl_kernel load = clCreateKernel(load_program, "load_kernel", &err);
+    check_cl_error(err, "clCreateKernel(load_kernel)");
+    const int load_elements = 1 << 20;
+    size_t load_global = load_elements;
+    cl_mem load_buffer = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(float) * load_elements, nullptr, &err);
+    check_cl_error(err, "clCreateBuffer(load)");
+    const float one = 1.0f;
+    check_cl_error(clEnqueueFillBuffer(queue, load_buffer, &one, sizeof(one), 0, sizeof(float) * load_elements, 0, nullptr, nullptr),
+                   "clEnqueueFillBuffer(load)");
+    check_cl_error(clFinish(queue), "clFinish(load init)");
+    check_cl_error(clSetKernelArg(load, 0, sizeof(cl_mem), &load_buffer), "clSetKernelArg(load_buffer)");
+    check_cl_error(clSetKernelArg(load, 1, sizeof(int), &load_elements), "clSetKernelArg(load_elements)");
+    cl_command_queue load_queue = create_queue(context, device, device_index);
+
+    cl_ulong largest_before = largest_usable_buffer(context, queue, max_alloc);
+
+    struct Distribution { const char* label; size_t ops; };
+    const Distribution distributions[] = {{"small", 2000}, {"mixed", 1000}, {"large", 200}};
+    std::ostringstream report;
+    report << "Device " << device_index << " (" << name << ") allocation churn, live set <= 64 allocations and "
+           << global_mem / 4 / worker_count / (1024 * 1024) << " MB per thread; latencies in us:\n";
+    report << "  " << std::left << std::setw(8) << "api" << std::setw(7) << "sizes" << std::right << std::setw(4) << "thr"
+           << std::setw(6) << "load" << std::setw(11) << "create p50" << std::setw(8) << "p99" << std::setw(9) << "p99.9"
+           << std::setw(10) << "touch p50" << std::setw(8) << "p99" << std::setw(12) << "release p50" << std::setw(8) << "p99"
+           << std::setw(7) << "drift" << std::setw(6) << "fail" << "\n";
+
+    for (bool svm : {false, true}) {
+        if (svm && !svm_supported) {
+            report << "  svm: coarse-grain SVM not supported, skipped\n";
+            continue;
+        }
+        for (int d = 0; d < 3; ++d) {
+            for (unsigned threads : {1u, worker_count}) {
+                for (bool busy : {false, true}) {
+                    std::atomic<bool> stop_load{false};
+                    std::thread load_thread;
+                    if (busy) {
+                        load_thread = std::thread([&] {
+                            while (!stop_load) {
+                                if (clEnqueueNDRangeKernel(load_queue, load, 1, nullptr, &load_global, nullptr, 0, nullptr, nullptr) != CL_SUCCESS ||
+                                    clFinish(load_queue) != CL_SUCCESS) break;
+                            }
+                        });
+                    }
+                    std::vector<ChurnSamples> samples(threads);
+                    std::vector<std::thread> workers;
+                    for (unsigned t = 0; t < threads; ++t) {
+                        workers.emplace_back(churn_worker, context, device, device_index, svm, d, distributions[d].ops,
+                                             global_mem / 4 / worker_count, max_alloc, 1234u + t, std::ref(samples[t]));
+                    }
+                    for (std::thread& worker : workers) worker.join();
+                    stop_load = true;
+                    if (load_thread.joinable()) load_thread.join();
+
+                    // Drift compares median create latency in the last quarter of each worker's run to the first.
+                    std::vector<double> create, touch, release, early, late;
+                    size_t failures = 0;
+                    for (const ChurnSamples& sample : samples) {
+                        size_t quarter = sample.create_us.size() / 4;
+                        early.insert(early.end(), sample.create_us.begin(), sample.create_us.begin() + quarter);
+                        late.insert(late.end(), sample.create_us.end() - quarter, sample.create_us.end());
+                        create.insert(create.end(), sample.create_us.begin(), sample.create_us.end());
+                        touch.insert(touch.end(), sample.touch_us.begin(), sample.touch_us.end());
+                        release.insert(release.end(), sample.release_us.begin(), sample.release_us.end());
+                        failures += sample.failures;
+                    }
+                    for (std::vector<double>* v : {&create, &touch, &release, &early, &late}) std::sort(v->begin(), v->end());
+                    double early_p50 = sorted_percentile(early, 0.5);
+                    report << "  " << std::left << std::setw(8) << (svm ? "svm" : "buffer") << std::setw(7) << distributions[d].label
+                           << std::right << std::setw(4) << threads << std::setw(6) << (busy ? "busy" : "idle") << std::fixed
+                           << std::setprecision(1) << std::setw(11) << sorted_percentile(create, 0.5) << std::setw(8)
+                           << sorted_percentile(create, 0.99) << std::setw(9) << sorted_percentile(create, 0.999) << std::setw(10)
+                           << sorted_percentile(touch, 0.5) << std::setw(8) << sorted_percentile(touch, 0.99) << std::setw(12)
+                           << sorted_percentile(release, 0.5) << std::setw(8) << sorted_percentile(release, 0.99) << std::setw(7)
+                           << std::setprecision(2) << (early_p50 > 0 ? sorted_percentile(late, 0.5) / early_p50 : 0.0)
+                           << std::setw(6) << failures << "\n";
+                }
+            }
+        }
+    }
+
+    cl_ulong largest_after = largest_usable_buffer(context, queue, max_alloc);
+    report << "  largest usable buffer: " << largest_before / (1024 * 1024) << " MB before churn, "
+           << largest_after / (1024 * 1024) << " MB after (allocation limit " << max_alloc / (1024 * 1024) << " MB)\n";
+
+    {
+        std::lock_guard<std::mutex> lock(g_output_mutex);
+        std::cout << report.str() << std::flush;
+    }
+
+    clReleaseCommandQueue(load_queue);
+    clReleaseMemObject(load_buffer);
+    clReleaseKernel(load);
+    clReleaseProgram(load_program);
+    clReleaseCommandQueue(queue);
+    clReleaseContext(context);
+}
+
+void run_oversub_on_device(cl_platform_id platform, cl_device_id device, int device_index) {
+    cl_int err;
+    std::string name = get_device_name(device);
+    std::cout << "Starting oversubscription test on Device " << device_index << ": " << name << std::endl;
+
+    cl_ulong global_mem = 0, max_alloc = 0;
+    cl_bool unified = CL_FALSE;
+    clGetDeviceInfo(device, CL_DEVICE_GLOBAL_MEM_SIZE, sizeof(global_mem), &global_mem, nullptr);
+    clGetDeviceInfo(device, CL_DEVICE_MAX_MEM_ALLOC_SIZE, sizeof(max_alloc), &max_alloc, nullptr);
+    clGetDeviceInfo(device, CL_DEVICE_HOST_UNIFIED_MEMORY, sizeof(unified), &unified, nullptr);
+    if (unified) {
+        // Global memory is system RAM here; oversubscribing it only exercises the host OOM killer.
+        std::lock_guard<std::mutex> lock(g_output_mutex);
+        std::cout << "Device " << device_index << " (" << name << "): unified memory, oversubscription test skipped." << std::endl;
+        return;
+    }
+
+    std::vector<size_t> working_sets = {50, 90, 110, 150, 200};
+    if (g_options.working_set_pct) working_sets = {g_options.working_set_pct};
+    const cl_ulong mb = 1024 * 1024;
+    cl_ulong buffer_bytes = std::min<cl_ulong>(max_alloc, 256 * mb) / mb * mb;
+    cl_ulong target = global_mem / 100 * *std::max_element(working_sets.begin(), working_sets.end());
+
+    cl_context context = create_context(platform, device);
+    cl_command_queue queue = create_queue(context, device, device_index);
+    cl_program program = build_program(context, device, device_index, oversubKernelSource, "-cl-std=CL1.2");
+    cl_kernel kernel = clCreateKernel(program, "oversub_touch", &err);
+    check_cl_error(err, "clCreateKernel(oversub_touch)");
+    size_t global = buffer_bytes / sizeof(cl_float4);
+
+    // Runs the kernel over one buffer and waits; returns wall-clock ms, which includes any paging
+    // the driver does before the kernel starts, or -1 with `err` set on failure.
+    auto access = [&](cl_mem buffer) {
+        auto start = std::chrono::steady_clock::now();
+        err = clSetKernelArg(kernel, 0, sizeof(cl_mem), &buffer);
+        if (err == CL_SUCCESS) err = clEnqueueNDRangeKernel(queue, kernel, 1, nullptr, &global, nullptr, 0, nullptr, nullptr);
+        if (err == CL_SUCCESS) err = clFinish(queue);
+        return err == CL_SUCCESS ? std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() : -1.0;
+    };
+
+    std::ostringstream report;
+    report << "Device " << device_index << " (" << name << ") oversubscription, " << global_mem / mb << " MB global memory, "
+           << buffer_bytes / mb << " MB buffers:\n";
+
+    // Allocate and touch buffers until the target or the first failure; first-touch bandwidth
+    // drops once new buffers stop fitting in VRAM.
+    std::vector<cl_mem> buffers;
+    const cl_float zero = 0.0f;
+    std::string failure;
+    report << "  allocation (first-touch GB/s per 10% of global memory):\n   ";
+    while (static_cast<cl_ulong>(buffers.size() + 1) * buffer_bytes <= target) {
+        cl_mem buffer = clCreateBuffer(context, CL_MEM_READ_WRITE, buffer_bytes, nullptr, &err);
+        if (err != CL_SUCCESS) {
+            failure = "clCreateBuffer returned " + std::to_string(err);
+            break;
+        }
+        auto start = std::chrono::steady_clock::now();
+        err = clEnqueueFillBuffer(queue, buffer, &zero, sizeof(zero), 0, buffer_bytes, 0, nullptr, nullptr);
+        if (err == CL_SUCCESS) err = clFinish(queue);
+        if (err != CL_SUCCESS) {
+            failure = "first touch returned " + std::to_string(err);
+            clReleaseMemObject(buffer);
+            break;
+        }
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        buffers.push_back(buffer);
+        cl_ulong allocated = buffers.size() * buffer_bytes;
+        if (allocated * 10 / global_mem != (allocated - buffer_bytes) * 10 / global_mem) {
+            report << " " << allocated * 100 / global_mem << "%:" << std::fixed << std::setprecision(1) << buffer_bytes / (ms * 1e6);
+        }
+    }
+    cl_ulong allocated = buffers.size() * buffer_bytes;
+    report << "\n  allocated " << allocated / mb << " MB (" << allocated * 100 / global_mem << "% of global memory); "
+           << (failure.empty() ? "no allocation failure up to the target" : "allocation failed at the next buffer: " + failure) << "\n";
+
+    // Rotate over working sets. Cyclic order defeats LRU eviction; random order and an 80/20
+    // hot set show how much locality recovers. Slowdown is relative to the first resident run.
+    report << "  " << std::right << std::setw(8) << "set %" << std::setw(9) << "buffers" << std::setw(9) << "pattern"
+           << std::setw(9) << "GB/s" << std::setw(10) << "slowdown" << std::setw(10) << "p50 ms" << std::setw(10) << "max ms"
+           << std::setw(14) << "extra ms/GB" << "\n";
+    std::mt19937 rng(42);
+    double baseline_ms_per_gb = 0.0;
+    bool failed = false;
+    for (size_t pct : working_sets) {
+        size_t count = static_cast<size_t>(global_mem / 100 * pct / buffer_bytes);
+        if (count == 0 || count > buffers.size()) {
+            report << "  " << std::setw(8) << pct << "  not enough buffers allocated, skipped\n";
+            continue;
+        }
+        for (const char* pattern : {"cyclic", "random", "hot"}) {
+            // Warm up with one cyclic pass so every row starts from the same residency state.
+            for (size_t b = 0; b < count && !failed; ++b) failed = access(buffers[b]) < 0;
+            std::vector<double> latencies;
+            size_t accesses = 2 * count;
+            for (size_t a = 0; a < accesses && !failed; ++a) {
+                size_t b = std::strcmp(pattern, "cyclic") == 0 ? a % count
+                         : std::strcmp(pattern, "random") == 0 || rng() % 10 < 2 ? rng() % count
+                                                                                   : rng() % std::max<size_t>(1, count / 5);
+                double ms = access(buffers[b]);
+                failed = ms < 0;
+                latencies.push_back(ms);
+            }
+            if (failed) {
+                report << "  " << std::setw(8) << pct << std::setw(9) << count << std::setw(9) << pattern
+                       << "  kernel failed (" << err << "), stopping\n";
+                break;
+            }
+            double total_ms = 0.0;
+            for (double ms : latencies) total_ms += ms;
+            double gb = accesses * static_cast<double>(buffer_bytes) / 1e9;
+            double ms_per_gb = total_ms / gb;
+            if (baseline_ms_per_gb == 0.0) baseline_ms_per_gb = ms_per_gb;
+            std::sort(latencies.begin(), latencies.end());
+            report << "  " << std::setw(8) << pct << std::setw(9) << count << std::setw(9) << pattern << std::fixed
+                   << std::setprecision(1) << std::setw(9) << gb / (total_ms * 1e-3) << std::setw(9) << std::setprecision(2)
+                   << ms_per_gb / baseline_ms_per_gb << "x" << std::setw(10) << sorted_percentile(latencies, 0.5) << std::setw(10)
+                   << latencies.back() << std::setw(14) << std::setprecision(1) << ms_per_gb - baseline_ms_per_gb << "\n";
+        }
+        if (failed) break;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(g_output_mutex);
+        std::cout << report.str() << std::flush;
+    }
+
+    clFinish(queue);
+    for (cl_mem buffer : buffers) clReleaseMemObject(buffer);
+    clReleaseKernel(kernel);
+    clReleaseProgram(program);
+    clReleaseCommandQueue(queue);
+    clReleaseContext(context);
+}
+
+void run_migration_on_platform(cl_platform_id platform, const std::vector<cl_device_id>& devices, int first_device_index) {
+    cl_int err;
+    size_t n = devices.size();
+    std::cout << "Starting cross-device migration benchmark on " << n << " device(s) in one shared context" << std::endl;
+    if (n < 2) {
+        std::cout << "Device " << first_device_index << ": only GPU on its platform, nothing to migrate between." << std::endl;
+        return;
+    }
+
+    cl_ulong max_alloc = 0;
+    for (cl_device_id device : devices) {
+        cl_ulong device_max = 0;
+        clGetDeviceInfo(device, CL_DEVICE_MAX_MEM_ALLOC_SIZE, sizeof(device_max), &device_max, nullptr);
+        max_alloc = max_alloc ? std::min(max_alloc, device_max) : device_max;
+    }
+    std::vector<size_t> sizes;
+    for (size_t bytes = 64 * 1024; bytes <= 256 * 1024 * 1024 && bytes <= max_alloc; bytes *= 16) sizes.push_back(bytes);
+
+    cl_context context = create_context(platform, devices);
+    std::vector<cl_command_queue> queues;
+    for (size_t d = 0; d < n; ++d) queues.push_back(create_queue(context, devices[d], first_device_index + static_cast<int>(d)));
+
+    // Puts fresh contents on `src`: an explicit migration there followed by a fill, so the
+    // measured step always starts from a buffer that is resident and dirty on the source.
+    const cl_uint pattern = 0x5A5A5A5A;
+    auto produce_on = [&](size_t src, cl_mem buffer, size_t bytes) {
+        check_cl_error(clEnqueueMigrateMemObjects(queues[src], 1, &buffer, 0, 0, nullptr, nullptr), "clEnqueueMigrateMemObjects(src)");
+        check_cl_error(clEnqueueFillBuffer(queues[src], buffer, &pattern, sizeof(pattern), 0, bytes, 0, nullptr, nullptr),
+                       "clEnqueueFillBuffer(src)");
+        check_cl_error(clFinish(queues[src]), "clFinish(src)");
+    };
+    // Mean wall-clock ms to make the buffer usable on `dst`. Explicit handoff migrates it;
+    // implicit handoff just writes 4 bytes on the destination queue and lets the runtime move it.
+    auto handoff_ms = [&](size_t src, size_t dst, size_t bytes, bool explicit_migrate) {
+        cl_mem buffer = clCreateBuffer(context, CL_MEM_READ_WRITE, bytes, nullptr, &err);
+        check_cl_error(err, "clCreateBuffer(migrate)");
+        double total_ms = 0.0;
+        for (int rep = 0; rep <= g_options.repeat; ++rep) {
+            produce_on(src, buffer, bytes);
+            auto start = std::chrono::steady_clock::now();
+            if (explicit_migrate) {
+                err = clEnqueueMigrateMemObjects(queues[dst], 1, &buffer, 0, 0, nullptr, nullptr);
+            } else {
+                err = clEnqueueFillBuffer(queues[dst], buffer, &pattern, sizeof(pattern), 0, sizeof(pattern), 0, nullptr, nullptr);
+            }
+            check_cl_error(err, explicit_migrate ? "clEnqueueMigrateMemObjects(dst)" : "clEnqueueFillBuffer(dst)");
+            check_cl_error(clFinish(queues[dst]), "clFinish(dst)");
+            if (rep > 0) total_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+        clReleaseMemObject(buffer);
+        return total_ms / g_options.repeat;
+    };
+
+    std::ostringstream report;
+    report << "Cross-device migration in a shared context (rows: source, columns: destination):\n";
+    for (size_t d = 0; d < n; ++d) {
+        report << "  D" << first_device_index + static_cast<int>(d) << " = " << get_device_name(devices[d]) << "\n";
+    }
+    auto matrix = [&](const std::string& title, size_t bytes, bool explicit_migrate, bool as_bandwidth) {
+        report << "  " << title << "\n    " << std::setw(8) << "";
+        for (size_t dst = 0; dst < n; ++dst) report << std::setw(10) << "D" + std::to_string(first_device_index + dst);
+        report << "\n";
+        for (size_t src = 0; src < n; ++src) {
+            report << "    " << std::setw(8) << "D" + std::to_string(first_device_index + src);
+            for (size_t dst = 0; dst < n; ++dst) {
+                if (src == dst) {
+                    report << std::setw(10) << "-";
+                    continue;
+                }
+                double ms = handoff_ms(src, dst, bytes, explicit_migrate);
+                report << std::fixed << std::setprecision(as_bandwidth ? 2 : 1) << std::setw(10)
+                       << (as_bandwidth ? bytes / (ms * 1e6) : ms * 1e3);
+            }
+            report << "\n";
+        }
+    };
+    matrix("latency, us, " + std::to_string(sizes.front() / 1024) + " KB explicit migration", sizes.front(), true, false);
+    matrix("latency, us, " + std::to_string(sizes.front() / 1024) + " KB implicit handoff", sizes.front(), false, false);
+    for (size_t bytes : sizes) {
+        matrix("bandwidth, GB/s, " + std::to_string(bytes / 1024) + " KB explicit migration", bytes, true, true);
+    }
+    matrix("bandwidth, GB/s, " + std::to_string(sizes.back() / 1024) + " KB implicit handoff", sizes.back(), false, true);
+
+    {
+        std::lock_guard<std::mutex> lock(g_output_mutex);
+        std::cout << report.str() << std::flush;
     }
+
+    for (cl_command_queue queue : queues) clReleaseCommandQueue(queue);
+    clReleaseContext(context);
 }
 
-void run_load_on_device(cl_platform_id platform, cl_device_id device, int device_index) {
+// Multi-GPU collectives staged through per-rank pinned host pools. The message is split into
+// n * kPipeline chunks and every chunk moves as read (source copy queue) -> write (destination
+// copy queue) -> optional add (destination compute queue), chained by events only, so chunks
+// from different ranks and steps overlap and reductions run while later chunks are in flight.
+void run_collectives_on_platform(cl_platform_id platform, const std::vector<cl_device_id>& devices, int first_device_index) {
     cl_int err;
-    char deviceName[128];
-    clGetDeviceInfo(device, CL_DEVICE_NAME, sizeof(deviceName), deviceName, NULL);
-    std::cout << "Starting load on Device " << device_index << ": " << deviceName << std::endl;
+    size_t n = devices.size();
+    std::cout << "Starting collectives benchmark on " << n << " device(s)" << std::endl;
+    if (n < 2) {
+        std::cout << "Device " << first_device_index << ": only GPU on its platform, no collectives to run." << std::endl;
+        return;
+    }
+    const size_t kPipeline = 4;
+    size_t chunks = n * kPipeline;
 
-    cl_context_properties props[] = {CL_CONTEXT_PLATFORM, (cl_context_properties)platform, 0};
-    cl_context context = clCreateContext(props, 1, &device, nullptr, nullptr, &err);
-    check_cl_error(err, "clCreateContext");
+    cl_context context = create_context(platform, devices);
+    cl_program program = build_program(context, devices[0], first_device_index, collectiveKernelSource, "-cl-std=CL1.2");
+    std::vector<cl_command_queue> copy_queues, compute_queues;
+    std::vector<cl_kernel> init_kernels, add_kernels;
+    for (size_t d = 0; d < n; ++d) {
+        copy_queues.push_back(create_queue(context, devices[d], first_device_index + static_cast<int>(d)));
+        compute_queues.push_back(create_queue(context, devices[d], first_device_index + static_cast<int>(d)));
+        init_kernels.push_back(clCreateKernel(program, "collective_init", &err));
+        check_cl_error(err, "clCreateKernel(collective_init)");
+        add_kernels.push_back(clCreateKernel(program, "collective_add", &err));
+        check_cl_error(err, "clCreateKernel(collective_add)");
+    }
 
-    // Create a command queue. clCreateCommandQueue is deprecated in OpenCL 2.0+,
-    // but often still available. clCreateCommandQueueWithProperties is preferred.
-    cl_command_queue queue = clCreateCommandQueueWithProperties(context, device, 0, &err);
-    if (err != CL_SUCCESS) { // Fallback for older OpenCL versions if WithProperties fails
-        std::cout << "Device " << device_index << ": clCreateCommandQueueWithProperties failed (" << err << "), trying clCreateCommandQueue." << std::endl;
-        queue = clCreateCommandQueue(context, device, 0, &err); // Deprecated in OpenCL 2.0
+    std::vector<size_t> sizes; // Message bytes per rank
+    for (size_t bytes = 256 * 1024; bytes <= g_options.size_mb * 1024 * 1024; bytes *= 4) sizes.push_back(bytes);
+    if (sizes.empty()) sizes.push_back(256 * 1024);
+    // One pool per rank, preferring that rank's NUMA node: a sender stages its chunks next to itself.
+    std::vector<PinnedPool> pools(n);
+    for (size_t d = 0; d < n; ++d) create_pinned_pool(pools[d], context, devices[d], sizes.back(), g_options.huge_pages);
+
+    std::ostringstream report;
+    report << "Collectives across";
+    for (size_t d = 0; d < n; ++d) report << (d ? ", " : " ") << "D" << first_device_index + static_cast<int>(d) << " (" << get_device_name(devices[d]) << ")";
+    report << "; host-staged through per-rank pinned pools (" << pools[0].backing << ", NUMA nodes";
+    for (size_t d = 0; d < n; ++d) report << (d ? "/" : " ") << (pools[d].numa_node >= 0 ? std::to_string(pools[d].numa_node) : "-");
+    report << "), " << kPipeline << " chunks per rank:\n";
+    report << "  " << std::left << std::setw(16) << "operation" << std::right << std::setw(10) << "size KB" << std::setw(10) << "ms"
+           << std::setw(12) << "algbw GB/s" << std::setw(12) << "busbw GB/s" << "  check\n";
+
+    for (size_t requested : sizes) {
+        size_t elements = requested / sizeof(cl_float) / chunks * chunks;
+        size_t chunk_elements = elements / chunks;
+        size_t chunk_bytes = chunk_elements * sizeof(cl_float);
+        size_t bytes = elements * sizeof(cl_float);
+
+        std::vector<cl_mem> data(n), recv(n);
+        for (size_t d = 0; d < n; ++d) {
+            data[d] = clCreateBuffer(context, CL_MEM_READ_WRITE, bytes, nullptr, &err);
+            check_cl_error(err, "clCreateBuffer(data)");
+            recv[d] = clCreateBuffer(context, CL_MEM_READ_WRITE, bytes, nullptr, &err);
+            check_cl_error(err, "clCreateBuffer(recv)");
+        }
+        // One staging slot per (sender, chunk) in the sender's pool, so senders never wait on each other's slots.
+        std::vector<PinnedBlock> staging(n);
+        for (size_t d = 0; d < n; ++d) {
+            staging[d] = acquire_pinned(pools[d], bytes);
+            if (staging[d].bytes == 0) throw std::runtime_error("pinned pool exhausted");
+        }
+
+        // Last event that touched each (rank, chunk) of data and recv, and the event after which the
+        // sender's staging slot for it has been read by every destination.
+        std::vector<std::vector<cl_event>> data_last, recv_last, host_last;
+        std::vector<cl_event> events;
+        auto wait_list = [](std::initializer_list<cl_event> candidates) {
+            std::vector<cl_event> list;
+            for (cl_event event : candidates) if (event) list.push_back(event);
+            return list;
+        };
+        // Moves chunk `c` of rank `src` to every rank in `dsts`: one read, then one write per
+        // destination, added into the destination's data when `reduce` is set.
+        auto send = [&](size_t src, const std::vector<size_t>& dsts, size_t c, bool reduce) {
+            size_t offset = c * chunk_bytes;
+            size_t slot = staging[src].offset + offset;
+            std::vector<cl_event> waits = wait_list({data_last[src][c], host_last[src][c]});
+            cl_event read_done;
+            check_cl_error(clEnqueueCopyBuffer(copy_queues[src], data[src], pools[src].slab, offset, slot, chunk_bytes,
+                                               static_cast<cl_uint>(waits.size()), waits.empty() ? nullptr : waits.data(), &read_done),
+                           "clEnqueueCopyBuffer(to host)");
+            events.push_back(read_done);
+            data_last[src][c] = read_done;
+            std::vector<cl_event> slot_writes; // Every read of the slot; its next overwrite waits on all of them
+            for (size_t dst : dsts) {
+                cl_mem target = reduce ? recv[dst] : data[dst];
+                waits = wait_list({read_done, reduce ? recv_last[dst][c] : data_last[dst][c]});
+                cl_event write_done;
+                check_cl_error(clEnqueueCopyBuffer(copy_queues[dst], pools[src].slab, target, slot, offset, chunk_bytes,
+                                                   static_cast<cl_uint>(waits.size()), waits.data(), &write_done),
+                               "clEnqueueCopyBuffer(from host)");
+                events.push_back(write_done);
+                slot_writes.push_back(write_done);
+                if (!reduce) {
+                    data_last[dst][c] = write_done;
+                    continue;
+                }
+                cl_uint element_offset = static_cast<cl_uint>(c * chunk_elements);
+                check_cl_error(clSetKernelArg(add_kernels[dst], 0, sizeof(cl_mem), &data[dst]), "clSetKernelArg(data)");
+                check_cl_error(clSetKernelArg(add_kernels[dst], 1, sizeof(cl_mem), &recv[dst]), "clSetKernelArg(recv)");
+                check_cl_error(clSetKernelArg(add_kernels[dst], 2, sizeof(cl_uint), &element_offset), "clSetKernelArg(element_offset)");
+                waits = wait_list({write_done, data_last[dst][c]});
+                cl_event add_done;
+                check_cl_error(clEnqueueNDRangeKernel(compute_queues[dst], add_kernels[dst], 1, nullptr, &chunk_elements, nullptr,
+                                                      static_cast<cl_uint>(waits.size()), waits.data(), &add_done),
+                               "clEnqueueNDRangeKernel(collective_add)");
+                events.push_back(add_done);
+                recv_last[dst][c] = add_done;
+                data_last[dst][c] = add_done;
+            }
+            if (slot_writes.size() == 1) {
+                host_last[src][c] = slot_writes[0];
+            } else {
+                cl_event drained;
+                check_cl_error(clEnqueueMarkerWithWaitList(copy_queues[src], static_cast<cl_uint>(slot_writes.size()), slot_writes.data(),
+                                                           &drained),
+                               "clEnqueueMarkerWithWaitList(slot)");
+                events.push_back(drained);
+                host_last[src][c] = drained;
+            }
+        };
+
+        auto broadcast = [&] {
+            std::vector<size_t> others;
+            for (size_t d = 1; d < n; ++d) others.push_back(d);
+            for (size_t c = 0; c < chunks; ++c) send(0, others, c, false);
+        };
+        auto all_gather = [&] { // Rank r owns chunks [r * kPipeline, (r + 1) * kPipeline)
+            for (size_t r = 0; r < n; ++r) {
+                std::vector<size_t> others;
+                for (size_t d = 0; d < n; ++d) if (d != r) others.push_back(d);
+                for (size_t c = r * kPipeline; c < (r + 1) * kPipeline; ++c) send(r, others, c, false);
+            }
+        };
+        auto ring_all_reduce = [&] { // Reduce-scatter then all-gather around the ring, one segment per rank
+            for (int phase = 0; phase < 2; ++phase) {
+                for (size_t step = 0; step + 1 < n; ++step) {
+                    for (size_t r = 0; r < n; ++r) {
+                        size_t segment = (r + n + phase - step % n) % n;
+                        for (size_t k = 0; k < kPipeline; ++k) send(r, {(r + 1) % n}, segment * kPipeline + k, phase == 0);
+                    }
+                }
+            }
+        };
+        auto tree_all_reduce = [&] { // Binomial reduction into rank 0, then a broadcast from it
+            for (size_t stride = 1; stride < n; stride *= 2) {
+                for (size_t r = stride; r < n; r += 2 * stride) {
+                    for (size_t c = 0; c < chunks; ++c) send(r, {r - stride}, c, true);
+                }
+            }
+            broadcast();
+        };
+
+        // Host model of each operation's result; every rank must end up with the same data.
+        auto initial = [](size_t i, size_t rank) { return static_cast<float>((i + 3 * rank) % 17); };
+        auto expected = [&](int op, size_t i) {
+            if (op == 0) return initial(i, 0);
+            if (op == 1) return initial(i, i / (kPipeline * chunk_elements));
+            float sum = 0.0f;
+            for (size_t r = 0; r < n; ++r) sum += initial(i, r);
+            return sum;
+        };
+
+        struct Operation { const char* label; std::function<void()> run; double bus_factor; };
+        const Operation operations[] = {
+            {"broadcast", broadcast, 1.0},
+            {"all-gather", all_gather, (n - 1.0) / n},
+            {"all-reduce ring", ring_all_reduce, 2.0 * (n - 1) / n},
+            {"all-reduce tree", tree_all_reduce, 2.0 * (n - 1) / n},
+        };
+        for (int op = 0; op < 4; ++op) {
+            double total_ms = 0.0;
+            bool ok = true;
+            for (int rep = 0; rep <= g_options.repeat; ++rep) {
+                for (size_t d = 0; d < n; ++d) {
+                    cl_uint rank = static_cast<cl_uint>(d);
+                    check_cl_error(clSetKernelArg(init_kernels[d], 0, sizeof(cl_mem), &data[d]), "clSetKernelArg(data)");
+                    check_cl_error(clSetKernelArg(init_kernels[d], 1, sizeof(cl_uint), &rank), "clSetKernelArg(rank)");
+                    check_cl_error(clEnqueueNDRangeKernel(compute_queues[d], init_kernels[d], 1, nullptr, &elements, nullptr, 0, nullptr, nullptr),
+                                   "clEnqueueNDRangeKernel(collective_init)");
+                }
+                for (size_t d = 0; d < n; ++d) check_cl_error(clFinish(compute_queues[d]), "clFinish(init)");
+                data_last.assign(n, std::vector<cl_event>(chunks, nullptr));
+                recv_last = data_last;
+                host_last = data_last;
+
+                auto start = std::chrono::steady_clock::now();
+                operations[op].run();
+                for (size_t d = 0; d < n; ++d) {
+                    check_cl_error(clFlush(copy_queues[d]), "clFlush(copy)");
+                    check_cl_error(clFlush(compute_queues[d]), "clFlush(compute)");
+                }
+                for (size_t d = 0; d < n; ++d) {
+                    check_cl_error(clFinish(copy_queues[d]), "clFinish(copy)");
+                    check_cl_error(clFinish(compute_queues[d]), "clFinish(compute)");
+                }
+                if (rep > 0) total_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                for (cl_event event : events) clReleaseEvent(event);
+                events.clear();
+
+                if (rep == g_options.repeat) { // Verify the last repetition on a strided sample of every rank
+                    size_t stride = std::max<size_t>(1, elements / 4096);
+                    std::vector<cl_float> result(elements);
+                    for (size_t d = 0; d < n && ok; ++d) {
+                        check_cl_error(clEnqueueReadBuffer(copy_queues[d], data[d], CL_TRUE, 0, bytes, result.data(), 0, nullptr, nullptr),
+                                       "clEnqueueReadBuffer(verify)");
+                        for (size_t i = 0; i < elements && ok; i += stride) ok = result[i] == expected(op, i);
+                    }
+                }
+            }
+            double ms = total_ms / g_options.repeat;
+            double algbw = bytes / (ms * 1e6);
+            report << "  " << std::left << std::setw(16) << operations[op].label << std::right << std::setw(10) << bytes / 1024
+                   << std::fixed << std::setprecision(3) << std::setw(10) << ms << std::setprecision(2) << std::setw(12) << algbw
+                   << std::setw(12) << algbw * operations[op].bus_factor << "  " << (ok ? "ok" : "MISMATCH") << "\n";
+        }
+
+        for (size_t d = 0; d < n; ++d) {
+            release_pinned(pools[d], staging[d]);
+            clReleaseMemObject(recv[d]);
+            clReleaseMemObject(data[d]);
+        }
     }
-    check_cl_error(err, "clCreateCommandQueue(WithProperties)");
 
+    {
+        std::lock_guard<std::mutex> lock(g_output_mutex);
+        std::cout << report.str() << std::flush;
+    }
 
-    cl_program program = clCreateProgramWithSource(context, 1, &kernelSource, nullptr, &err);
-    check_cl_error(err, "clCreateProgramWithSource");
+    for (size_t d = 0; d < n; ++d) {
+        clReleaseKernel(add_kernels[d]);
+        clReleaseKernel(init_kernels[d]);
+        clReleaseCommandQueue(compute_queues[d]);
+        clReleaseCommandQueue(copy_queues[d]);
+        release_pinned_pool(pools[d]);
+    }
+    clReleaseProgram(program);
+    clReleaseContext(context);
+}
 
-    // Try to build for OpenCL 1.2, which is very common.
-    // If you need features from newer versions and your hardware/driver supports it, you can change this.
-    err = clBuildProgram(program, 1, &device, "-cl-std=CL1.2", nullptr, nullptr);
-    if (err != CL_SUCCESS) {
-        size_t log_size;
-        clGetProgramBuildInfo(program, device, CL_PROGRAM_BUILD_LOG, 0, nullptr, &log_size);
-        std::vector<char> log(log_size);
-        clGetProgramBuildInfo(program, device, CL_PROGRAM_BUILD_LOG, log_size, log.data(), nullptr);
-        std::cerr << "Device " << device_index << " Kernel build log:\n" << log.data() << std::endl;
-        check_cl_error(err, "clBuildProgram");
+void run_pinned_on_device(cl_platform_id platform, cl_device_id device, int device_index) {
+    cl_int err;
+    std::string name = get_device_name(device);
+    std::cout << "Starting pinned host pool benchmark on Device " << device_index << ": " << name << std::endl;
+
+    std::vector<size_t> sizes;
+    for (size_t bytes = 64 * 1024; bytes <= g_options.size_mb * 1024 * 1024; bytes *= 4) sizes.push_back(bytes);
+    if (sizes.empty()) sizes.push_back(64 * 1024);
+    size_t max_bytes = sizes.back();
+
+    cl_context context = create_context(platform, device);
+    cl_command_queue queue = create_queue(context, device, device_index);
+    cl_mem device_buffer = clCreateBuffer(context, CL_MEM_READ_WRITE, max_bytes, nullptr, &err);
+    check_cl_error(err, "clCreateBuffer(device)");
+    const cl_uint pattern = 0xA5A5A5A5;
+    check_cl_error(clEnqueueFillBuffer(queue, device_buffer, &pattern, sizeof(pattern), 0, max_bytes, 0, nullptr, nullptr),
+                   "clEnqueueFillBuffer(device)");
+    PinnedPool pool;
+    create_pinned_pool(pool, context, device, max_bytes, g_options.huge_pages);
+    check_cl_error(clFinish(queue), "clFinish(setup)");
+
+    std::ostringstream report;
+    report << "Device " << device_index << " (" << name << ") host transfers; pool of " << pool.bytes / (1024 * 1024) << " MB on "
+           << pool.backing << ", NUMA node " << (pool.numa_node >= 0 ? std::to_string(pool.numa_node) : "unbound") << ", set up once in "
+           << std::fixed << std::setprecision(1) << pool.setup_ms << " ms.\n"
+           << "  alloc = per-transfer staging allocation cost; effective includes it.\n";
+    report << "  " << std::left << std::setw(10) << "path" << std::right << std::setw(10) << "size KB" << std::setw(11) << "alloc us"
+           << std::setw(11) << "D2H GB/s" << std::setw(11) << "H2D GB/s" << std::setw(15) << "effective GB/s" << "\n";
+
+    auto seconds_since = [](std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+    for (size_t bytes : sizes) {
+        for (const char* path : {"pageable", "ad-hoc", "pool"}) {
+            double alloc_s = 0.0, d2h_s = 0.0, h2d_s = 0.0;
+            for (int rep = 0; rep <= g_options.repeat; ++rep) {
+                double alloc = 0.0, d2h = 0.0, h2d = 0.0;
+                auto start = std::chrono::steady_clock::now();
+                if (std::strcmp(path, "pageable") == 0) {
+                    // A fresh vector per transfer, as a one-off readback would do
+                    std::vector<char> staging(bytes);
+                    alloc = seconds_since(start);
+                    start = std::chrono::steady_clock::now();
+                    check_cl_error(clEnqueueReadBuffer(queue, device_buffer, CL_TRUE, 0, bytes, staging.data(), 0, nullptr, nullptr),
+                                   "clEnqueueReadBuffer(pageable)");
+                    d2h = seconds_since(start);
+                    start = std::chrono::steady_clock::now();
+                    check_cl_error(clEnqueueWriteBuffer(queue, device_buffer, CL_TRUE, 0, bytes, staging.data(), 0, nullptr, nullptr),
+                                   "clEnqueueWriteBuffer(pageable)");
+                    h2d = seconds_since(start);
+                } else if (std::strcmp(path, "ad-hoc") == 0) {
+                    // Driver-pinned memory allocated and mapped for this transfer only
+                    cl_mem pinned = clCreateBuffer(context, CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR, bytes, nullptr, &err);
+                    check_cl_error(err, "clCreateBuffer(ad-hoc pinned)");
+                    void* host = clEnqueueMapBuffer(queue, pinned, CL_TRUE, CL_MAP_READ | CL_MAP_WRITE, 0, bytes, 0, nullptr, nullptr, &err);
+                    check_cl_error(err, "clEnqueueMapBuffer(ad-hoc pinned)");
+                    alloc = seconds_since(start);
+                    start = std::chrono::steady_clock::now();
+                    check_cl_error(clEnqueueReadBuffer(queue, device_buffer, CL_TRUE, 0, bytes, host, 0, nullptr, nullptr),
+                                   "clEnqueueReadBuffer(ad-hoc pinned)");
+                    d2h = seconds_since(start);
+                    start = std::chrono::steady_clock::now();
+                    check_cl_error(clEnqueueWriteBuffer(queue, device_buffer, CL_TRUE, 0, bytes, host, 0, nullptr, nullptr),
+                                   "clEnqueueWriteBuffer(ad-hoc pinned)");
+                    h2d = seconds_since(start);
+                    start = std::chrono::steady_clock::now();
+                    clEnqueueUnmapMemObject(queue, pinned, host, 0, nullptr, nullptr);
+                    clFinish(queue);
+                    clReleaseMemObject(pinned);
+                    alloc += seconds_since(start);
+                } else {
+                    PinnedBlock block = acquire_pinned(pool, bytes);
+                    if (block.bytes == 0) throw std::runtime_error("pinned pool exhausted");
+                    alloc = seconds_since(start);
+                    start = std::chrono::steady_clock::now();
+                    check_cl_error(clEnqueueCopyBuffer(queue, device_buffer, pool.slab, 0, block.offset, bytes, 0, nullptr, nullptr),
+                                   "clEnqueueCopyBuffer(to pool)");
+                    check_cl_error(clFinish(queue), "clFinish(to pool)");
+                    d2h = seconds_since(start);
+                    start = std::chrono::steady_clock::now();
+                    check_cl_error(clEnqueueCopyBuffer(queue, pool.slab, device_buffer, block.offset, 0, bytes, 0, nullptr, nullptr),
+                                   "clEnqueueCopyBuffer(from pool)");
+                    check_cl_error(clFinish(queue), "clFinish(from pool)");
+                    h2d = seconds_since(start);
+                    start = std::chrono::steady_clock::now();
+                    release_pinned(pool, block);
+                    alloc += seconds_since(start);
+                }
+                if (rep == 0) continue; // Warmup
+                alloc_s += alloc;
+                d2h_s += d2h;
+                h2d_s += h2d;
+            }
+            double reps = g_options.repeat;
+            report << "  " << std::left << std::setw(10) << path << std::right << std::setw(10) << bytes / 1024 << std::fixed
+                   << std::setprecision(1) << std::setw(11) << alloc_s / reps * 1e6 << std::setprecision(2) << std::setw(11)
+                   << bytes / (d2h_s / reps * 1e9) << std::setw(11) << bytes / (h2d_s / reps * 1e9) << std::setw(15)
+                   << 2.0 * bytes / ((alloc_s + d2h_s + h2d_s) / reps * 1e9) << "\n";
+        }
     }
 
-    cl_kernel kernel = clCreateKernel(program, "load_kernel", &err);
-    check_cl_error(err, "clCreateKernel");
+    {
+        std::lock_guard<std::mutex> lock(g_output_mutex);
+        std::cout << report.str() << std::flush;
+    }
 
-    // Adjust dataSize based on GPU memory and desired parallelism
-    // Larger dataSize means more work items if global_work_size is tied to it.
-    const size_t dataSizeElements = 1024 * 1024 * 8; // 8M floats -> 32MB
-    std::vector<float> host_data(dataSizeElements);
-    for(size_t i = 0; i < dataSizeElements; ++i) host_data[i] = static_cast<float>(i % 100) + 0.1f; // Simple initial data
+    release_pinned_pool(pool);
+    clReleaseMemObject(device_buffer);
+    clReleaseCommandQueue(queue);
+    clReleaseContext(context);
+}
 
-    cl_mem buffer = clCreateBuffer(context, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR,
-                                   sizeof(float) * dataSizeElements, host_data.data(), &err);
-    check_cl_error(err, "clCreateBuffer");
+// Minimal io_uring over the raw syscalls, so streaming needs no liburing at build time. Only
+// what the stream mode uses: single writes and polled completions.
+struct IoRing {
+    int fd = -1;
+    unsigned entries = 0;
+    void* sq_map = nullptr;
+    void* cq_map = nullptr;
+    size_t sq_map_bytes = 0, cq_map_bytes = 0, sqes_bytes = 0;
+    io_uring_sqe* sqes = nullptr;
+    io_uring_cqe* cqes = nullptr;
+    unsigned *sq_head = nullptr, *sq_tail = nullptr, *sq_mask = nullptr, *sq_array = nullptr;
+    unsigned *cq_head = nullptr, *cq_tail = nullptr, *cq_mask = nullptr;
+    unsigned unsubmitted = 0; // Published in the SQ ring but not yet accepted by io_uring_enter
+};
 
-    err = clSetKernelArg(kernel, 0, sizeof(cl_mem), &buffer);
-    check_cl_error(err, "clSetKernelArg(buffer)");
-    int count_arg = static_cast<int>(dataSizeElements);
-    err = clSetKernelArg(kernel, 1, sizeof(int), &count_arg);
-    check_cl_error(err, "clSetKernelArg(count)");
+void release_io_ring(IoRing& ring) {
+    if (ring.sqes) munmap(ring.sqes, ring.sqes_bytes);
+    if (ring.cq_map && ring.cq_map != ring.sq_map) munmap(ring.cq_map, ring.cq_map_bytes);
+    if (ring.sq_map) munmap(ring.sq_map, ring.sq_map_bytes);
+    if (ring.fd >= 0) close(ring.fd);
+    ring = IoRing();
+}
 
-    size_t global_work_size = dataSizeElements;
-    // Local work size can be tuned. Query CL_KERNEL_WORK_GROUP_SIZE for optimal values or pass NULL.
-    // size_t local_work_size = 256;
+// Returns false (with errno set) when io_uring is unavailable, e.g. blocked in a container.
+bool create_io_ring(IoRing& ring, unsigned entries) {
+    io_uring_params params = {};
+    ring.fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+    if (ring.fd < 0) return false;
+    ring.entries = params.sq_entries;
+    ring.sq_map_bytes = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring.cq_map_bytes = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single_map = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_map) ring.sq_map_bytes = ring.cq_map_bytes = std::max(ring.sq_map_bytes, ring.cq_map_bytes);
+    ring.sq_map = mmap(nullptr, ring.sq_map_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_SQ_RING);
+    if (ring.sq_map == MAP_FAILED) {
+        ring.sq_map = nullptr;
+        release_io_ring(ring);
+        return false;
+    }
+    ring.cq_map = single_map ? ring.sq_map
+                             : mmap(nullptr, ring.cq_map_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_CQ_RING);
+    ring.sqes_bytes = params.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = mmap(nullptr, ring.sqes_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_SQES);
+    if (ring.cq_map == MAP_FAILED || sqes == MAP_FAILED) {
+        if (ring.cq_map == MAP_FAILED) ring.cq_map = nullptr;
+        if (sqes != MAP_FAILED) munmap(sqes, ring.sqes_bytes);
+        release_io_ring(ring);
+        return false;
+    }
+    ring.sqes = static_cast<io_uring_sqe*>(sqes);
+    char* sq = static_cast<char*>(ring.sq_map);
+    ring.sq_head = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    ring.sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    ring.sq_mask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    ring.sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    char* cq = static_cast<char*>(ring.cq_map);
+    ring.cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    ring.cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    ring.cq_mask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    ring.cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    return true;
+}
 
-    std::cout << "Device " << device_index << ": Entering continuous kernel execution loop..." << std::endl;
-    while (true) {
-        err = clEnqueueNDRangeKernel(queue, kernel, 1, nullptr, &global_work_size, nullptr /* or &local_work_size */, 0, nullptr, nullptr);
-        if (err != CL_SUCCESS) {
-            std::cerr << "Device " << device_index << ": clEnqueueNDRangeKernel failed: " << err << std::endl;
-            // Consider whether to break or retry. For a continuous load, breaking might be okay if error is persistent.
-            break;
+// Passes published writes to the kernel; with `wait`, also blocks for one completion. A failed
+// enter leaves the writes published, so they are retried by the next call, never dropped.
+void submit_io_writes(IoRing& ring, bool wait) {
+    if (ring.unsubmitted == 0 && !wait) return;
+    long submitted = syscall(__NR_io_uring_enter, ring.fd, ring.unsubmitted, wait ? 1 : 0, wait ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+    if (submitted > 0) ring.unsubmitted -= static_cast<unsigned>(submitted);
+}
+
+// Publishes one write and submits it. Returns false only when the queue is full, in which case
+// nothing was published and the caller may write another way. Once this returns true the write
+// completes through the ring, even if this submission attempt itself failed.
+bool queue_io_write(IoRing& ring, int fd, const void* data, unsigned bytes, unsigned long long offset, unsigned long long tag) {
+    unsigned tail = *ring.sq_tail;
+    if (tail - __atomic_load_n(ring.sq_head, __ATOMIC_ACQUIRE) >= ring.entries) return false;
+    unsigned index = tail & *ring.sq_mask;
+    io_uring_sqe* sqe = &ring.sqes[index];
+    std::memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_WRITE;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<unsigned long long>(data);
+    sqe->len = bytes;
+    sqe->off = offset;
+    sqe->user_data = tag;
+    ring.sq_array[index] = index;
+    __atomic_store_n(ring.sq_tail, tail + 1, __ATOMIC_RELEASE);
+    ++ring.unsubmitted;
+    submit_io_writes(ring, false);
+    return true;
+}
+
+// Hands every completed write to `on_complete(tag, result)`; with `wait`, blocks for at least one.
+size_t reap_io_completions(IoRing& ring, bool wait, const std::function<void(unsigned long long, int)>& on_complete) {
+    submit_io_writes(ring, wait && __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE) == *ring.cq_head);
+    size_t completed = 0;
+    unsigned head = *ring.cq_head;
+    while (head != __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE)) {
+        const io_uring_cqe& cqe = ring.cqes[head & *ring.cq_mask];
+        on_complete(cqe.user_data, cqe.res);
+        ++head;
+        ++completed;
+    }
+    __atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+    return completed;
+}
+
+double event_ms(cl_event event) {
+    cl_ulong start = 0, end = 0;
+    clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_START, sizeof(start), &start, nullptr);
+    clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_END, sizeof(end), &end, nullptr);
+    return (end - start) * 1e-6;
+}
+
+// Device -> pinned host -> storage pipeline. The device alternates between two output buffers;
+// each finished chunk is copied into a free pinned slot and written out with io_uring while the
+// next chunk is produced. When storage falls behind and no slot is free, the host waits for one
+// while the device finishes the chunk already queued, and the device then waits for its output
+// buffer: every chunk reaches the file. --stream-drop instead drops and counts such chunks so the
+// device never waits, at the cost of an incomplete file.
+void run_stream_on_device(cl_platform_id platform, cl_device_id device, int device_index) {
+    cl_int err;
+    std::string name = get_device_name(device);
+    if (g_options.stream_dir.empty()) {
+        std::lock_guard<std::mutex> lock(g_output_mutex);
+        std::cout << "Device " << device_index << ": stream mode needs --stream-dir, skipping." << std::endl;
+        return;
+    }
+    // Linux caps a single write at 0x7ffff000 bytes, so larger chunks would always come back short.
+    if (g_options.size_mb >= 2048) {
+        std::lock_guard<std::mutex> lock(g_output_mutex);
+        std::cout << "Device " << device_index << ": stream mode needs --size-mb below 2048, skipping." << std::endl;
+        return;
+    }
+    std::cout << "Starting device-to-storage stream on Device " << device_index << ": " << name << std::endl;
+
+    const size_t kSlots = 2; // Double-buffered pinned staging
+    size_t chunk_bytes = g_options.size_mb * 1024 * 1024;
+    size_t vectors = chunk_bytes / sizeof(cl_uint4);
+    // Without --duration/--iterations the stream is bounded to 32 chunks rather than filling the disk.
+    size_t chunk_limit = g_options.duration_s || g_options.iterations ? 0 : 32;
+
+    std::string path = g_options.stream_dir + "/gpu-stream-dev" + std::to_string(device_index) + ".bin";
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | (g_options.direct_io ? O_DIRECT : 0), 0644);
+    if (fd < 0) throw std::runtime_error("open " + path + ": " + std::strerror(errno));
+    IoRing ring;
+    bool use_ring = create_io_ring(ring, 2 * kSlots);
+    std::string ring_error = use_ring ? "" : std::strerror(errno);
+
+    cl_context context = create_context(platform, device);
+    cl_command_queue compute_queue = create_queue(context, device, device_index, CL_QUEUE_PROFILING_ENABLE);
+    cl_command_queue copy_queue = create_queue(context, device, device_index, CL_QUEUE_PROFILING_ENABLE);
+    cl_program program = build_program(context, device, device_index, streamKernelSource, "-cl-std=CL1.2");
+    cl_kernel kernel = clCreateKernel(program, "stream_produce", &err);
+    check_cl_error(err, "clCreateKernel(stream_produce)");
+    cl_mem outputs[2];
+    for (cl_mem& output : outputs) {
+        output = clCreateBuffer(context, CL_MEM_WRITE_ONLY, chunk_bytes, nullptr, &err);
+        check_cl_error(err, "clCreateBuffer(stream output)");
+    }
+    PinnedPool pool;
+    create_pinned_pool(pool, context, device, kSlots * chunk_bytes, g_options.huge_pages);
+
+    enum class SlotState { Free, Copying, Writing };
+    struct Slot {
+        SlotState state = SlotState::Free;
+        PinnedBlock block;
+        cl_event copied = nullptr; // Copy into the slot, then the map that publishes it to the host
+        cl_event mapped = nullptr;
+        void* host = nullptr;
+        std::chrono::steady_clock::time_point write_start;
+    };
+    std::vector<Slot> slots(kSlots);
+    for (Slot& slot : slots) slot.block = acquire_pinned(pool, chunk_bytes);
+
+    size_t produced = 0, written = 0, dropped = 0, write_errors = 0;
+    double produce_ms = 0.0, copy_ms = 0.0, write_ms = 0.0;
+    unsigned long long file_offset = 0;
+
+    auto finish_write = [&](size_t index, long long result) {
+        Slot& slot = slots[index];
+        write_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - slot.write_start).count();
+        if (result == static_cast<long long>(chunk_bytes)) ++written;
+        else ++write_errors;
+        check_cl_error(clEnqueueUnmapMemObject(copy_queue, pool.slab, slot.host, 0, nullptr, nullptr), "clEnqueueUnmapMemObject(slot)");
+        clReleaseEvent(slot.mapped);
+        clReleaseEvent(slot.copied);
+        slot.state = SlotState::Free;
+    };
+    // Moves slots along: mapped copies go to storage, finished writes free their slot.
+    // With `wait`, blocks until at least one of those happens.
+    auto service = [&](bool wait) {
+        bool progressed = false;
+        for (size_t index = 0; index < slots.size(); ++index) {
+            Slot& slot = slots[index];
+            if (slot.state != SlotState::Copying) continue;
+            cl_int status = CL_QUEUED;
+            clGetEventInfo(slot.mapped, CL_EVENT_COMMAND_EXECUTION_STATUS, sizeof(status), &status, nullptr);
+            if (status != CL_COMPLETE) continue;
+            copy_ms += event_ms(slot.copied);
+            slot.state = SlotState::Writing;
+            slot.write_start = std::chrono::steady_clock::now();
+            progressed = true;
+            // A queued write stays in Writing until its completion arrives; pwrite only
+            // covers a full ring, where nothing was handed to io_uring.
+            bool queued = use_ring && queue_io_write(ring, fd, slot.host, static_cast<unsigned>(chunk_bytes), file_offset, index);
+            if (!queued) finish_write(index, pwrite(fd, slot.host, chunk_bytes, static_cast<off_t>(file_offset)));
+            file_offset += chunk_bytes;
         }
-        // clFinish ensures the kernel completes before the C++ loop re-enqueues it.
-        // This makes the load more "serial" in terms of C++ loop iterations,
-        // but the GPU is kept busy during each kernel's execution.
-        err = clFinish(queue);
-        if (err != CL_SUCCESS) {
-            std::cerr << "Device " << device_index << ": clFinish failed: " << err << std::endl;
-            break;
+        if (use_ring) {
+            bool writing = std::any_of(slots.begin(), slots.end(), [](const Slot& slot) { return slot.state == SlotState::Writing; });
+            progressed |= reap_io_completions(ring, wait && !progressed && writing,
+                                              [&](unsigned long long index, int result) { finish_write(index, result); }) > 0;
         }
-        // No sleep needed if you want to keep the GPU as busy as possible by immediately re-queueing.
-        // std::this_thread::sleep_for(std::chrono::milliseconds(1)); // Optional small delay
+        if (wait && !progressed) {
+            for (Slot& slot : slots) {
+                if (slot.state == SlotState::Copying) {
+                    clWaitForEvents(1, &slot.mapped);
+                    break;
+                }
+            }
+        }
+    };
+    // Hands a finished chunk to a free pinned slot. When storage is behind it waits for a slot to
+    // drain, or with --stream-drop drops the chunk.
+    auto stage = [&](cl_mem output, cl_event output_ready) {
+        auto is_free = [](const Slot& slot) { return slot.state == SlotState::Free; };
+        service(false);
+        auto free_slot = std::find_if(slots.begin(), slots.end(), is_free);
+        if (free_slot == slots.end() && g_options.stream_drop) {
+            ++dropped;
+            return (cl_event) nullptr;
+        }
+        for (; free_slot == slots.end(); free_slot = std::find_if(slots.begin(), slots.end(), is_free)) service(true);
+        check_cl_error(clEnqueueCopyBuffer(copy_queue, output, pool.slab, 0, free_slot->block.offset, chunk_bytes, 1, &output_ready,
+                                           &free_slot->copied),
+                       "clEnqueueCopyBuffer(stream readback)");
+        free_slot->host = clEnqueueMapBuffer(copy_queue, pool.slab, CL_FALSE, CL_MAP_READ, free_slot->block.offset, chunk_bytes, 1,
+                                             &free_slot->copied, &free_slot->mapped, &err);
+        check_cl_error(err, "clEnqueueMapBuffer(slot)");
+        check_cl_error(clFlush(copy_queue), "clFlush(copy)");
+        free_slot->state = SlotState::Copying;
+        clRetainEvent(free_slot->copied);
+        return free_slot->copied;
+    };
+
+    LoopStats stats;
+    cl_event ready[2] = {nullptr, nullptr};    // Chunk produced into outputs[i]
+    cl_event consumed[2] = {nullptr, nullptr}; // Readback of outputs[i] finished reading it
+    for (cl_uint sequence = 0; !stats.done() && (!chunk_limit || sequence < chunk_limit); ++sequence) {
+        auto launch = std::chrono::steady_clock::now();
+        int current = sequence % 2, previous = 1 - current;
+        check_cl_error(clSetKernelArg(kernel, 0, sizeof(cl_mem), &outputs[current]), "clSetKernelArg(outputs)");
+        check_cl_error(clSetKernelArg(kernel, 1, sizeof(cl_uint), &sequence), "clSetKernelArg(sequence)");
+        cl_event produced_event;
+        check_cl_error(clEnqueueNDRangeKernel(compute_queue, kernel, 1, nullptr, &vectors, nullptr, consumed[current] ? 1 : 0,
+                                              consumed[current] ? &consumed[current] : nullptr, &produced_event),
+                       "clEnqueueNDRangeKernel(stream_produce)");
+        check_cl_error(clFlush(compute_queue), "clFlush(compute)");
+        if (consumed[current]) clReleaseEvent(consumed[current]);
+        consumed[current] = nullptr;
+        ready[current] = produced_event;
+        ++produced;
+        // The previous chunk is staged while this one is produced, so the device never idles on the host.
+        if (ready[previous]) {
+            check_cl_error(clWaitForEvents(1, &ready[previous]), "clWaitForEvents(produce)");
+            produce_ms += event_ms(ready[previous]);
+            consumed[previous] = stage(outputs[previous], ready[previous]);
+            clReleaseEvent(ready[previous]);
+            ready[previous] = nullptr;
+        }
+        stats.record(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - launch).count());
+    }
+    // Drain: stage the last chunk, then let every slot finish its write.
+    for (int i = 0; i < 2; ++i) {
+        if (!ready[i]) continue;
+        check_cl_error(clWaitForEvents(1, &ready[i]), "clWaitForEvents(produce)");
+        produce_ms += event_ms(ready[i]);
+        cl_event copied = stage(outputs[i], ready[i]);
+        if (copied) clReleaseEvent(copied);
+        clReleaseEvent(ready[i]);
     }
+    while (std::any_of(slots.begin(), slots.end(), [](const Slot& slot) { return slot.state != SlotState::Free; })) service(true);
+    check_cl_error(clFinish(copy_queue), "clFinish(copy)");
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - stats.start).count();
 
-    std::cout << "Device " << device_index << ": Exited kernel execution loop." << std::endl;
-    clReleaseMemObject(buffer);
+    std::ostringstream report;
+    report << "Device " << device_index << " (" << name << ") stream to " << path << ", " << g_options.size_mb << " MB chunks, "
+           << kSlots << " pinned slots (" << pool.backing << "), " << (use_ring ? "io_uring" : "pwrite (io_uring: " + ring_error + ")")
+           << (g_options.direct_io ? ", O_DIRECT" : ", page cache") << ":\n" << std::fixed << std::setprecision(2)
+           << "  produce    " << std::setw(8) << produced * chunk_bytes / (produce_ms * 1e6) << " GB/s device time\n"
+           << "  readback   " << std::setw(8) << (written + write_errors) * chunk_bytes / (copy_ms * 1e6) << " GB/s copy time\n"
+           << "  storage    " << std::setw(8) << (written + write_errors) * chunk_bytes / (write_ms * 1e6) << " GB/s per write, "
+           << write_ms / std::max<size_t>(1, written + write_errors) << " ms mean write latency\n"
+           << "  end-to-end " << std::setw(8) << written * chunk_bytes / (elapsed * 1e9) << " GB/s written over " << std::setprecision(1)
+           << elapsed << " s\n"
+           << "  chunks: " << produced << " produced, " << written << " written, " << dropped << " dropped (storage backpressure), "
+           << write_errors << " failed writes" << (g_stop_requested ? " (interrupted)" : "") << "\n";
+    if (dropped || write_errors) {
+        report << "  " << path << " is INCOMPLETE: " << dropped + write_errors << " of " << produced << " chunks are missing\n";
+    }
+    {
+        std::lock_guard<std::mutex> lock(g_output_mutex);
+        std::cout << report.str() << std::flush;
+    }
+
+    for (int i = 0; i < 2; ++i) {
+        if (consumed[i]) clReleaseEvent(consumed[i]);
+    }
+    if (use_ring) release_io_ring(ring);
+    close(fd);
+    for (Slot& slot : slots) release_pinned(pool, slot.block);
+    release_pinned_pool(pool);
+    for (cl_mem output : outputs) clReleaseMemObject(output);
     clReleaseKernel(kernel);
     clReleaseProgram(program);
-    clReleaseCommandQueue(queue);
+    clReleaseCommandQueue(copy_queue);
+    clReleaseCommandQueue(compute_queue);
     clReleaseContext(context);
-    std::cout << "Finished load and cleaned up for Device " << device_index << std::endl;
 }
 
-int main() {
+// One participant of the fairness benchmark: a private context running load_kernel.
+struct FairnessContext {
+    cl_context context = nullptr;
+    cl_command_queue queue = nullptr;
+    cl_program program = nullptr;
+    cl_kernel kernel = nullptr;
+    cl_mem buffer = nullptr;
+    size_t global = 1 << 20;
+};
+
+FairnessContext create_fairness_context(cl_platform_id platform, cl_device_id device, int device_index) {
+    cl_int err;
+    FairnessContext fc;
+    fc.context = create_context(platform, device);
+    fc.queue = create_queue(fc.context, device, device_index);
+    fc.program = build_program(fc.context, device, device_index, kernelSource, "-cl-std=CL1.2");
+    fc.kernel = clCreateKernel(fc.program, "load_kernel", &err);
+    check_cl_error(err, "clCreateKernel(load_kernel)");
+    fc.buffer = clCreateBuffer(fc.context, CL_MEM_READ_WRITE, sizeof(float) * fc.global, nullptr, &err);
+    check_cl_error(err, "clCreateBuffer(fairness)");
+    const float one = 1.0f;
+    check_cl_error(clEnqueueFillBuffer(fc.queue, fc.buffer, &one, sizeof(one), 0, sizeof(float) * fc.global, 0, nullptr, nullptr),
+                   "clEnqueueFillBuffer(fairness)");
+    int count = static_cast<int>(fc.global);
+    check_cl_error(clSetKernelArg(fc.kernel, 0, sizeof(cl_mem), &fc.buffer), "clSetKernelArg(buffer)");
+    check_cl_error(clSetKernelArg(fc.kernel, 1, sizeof(int), &count), "clSetKernelArg(count)");
+    check_cl_error(clFinish(fc.queue), "clFinish(fairness setup)");
+    return fc;
+}
+
+// Relaunches load_kernel back to back for `seconds`; returns the number that completed.
+size_t run_fairness_context(FairnessContext& fc, double seconds) {
+    auto start = std::chrono::steady_clock::now();
+    size_t kernels = 0;
+    while (!g_stop_requested && std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() < seconds) {
+        check_cl_error(clEnqueueNDRangeKernel(fc.queue, fc.kernel, 1, nullptr, &fc.global, nullptr, 0, nullptr, nullptr),
+                       "clEnqueueNDRangeKernel(fairness)");
+        check_cl_error(clFinish(fc.queue), "clFinish(fairness)");
+        ++kernels;
+    }
+    return kernels;
+}
+
+void release_fairness_context(FairnessContext& fc) {
+    clReleaseMemObject(fc.buffer);
+    clReleaseKernel(fc.kernel);
+    clReleaseProgram(fc.program);
+    clReleaseCommandQueue(fc.queue);
+    clReleaseContext(fc.context);
+}
+
+double fairness_seconds() { return g_options.duration_s ? static_cast<double>(g_options.duration_s) : 10.0; }
+
+// Child side of --processes: set up, report ready, wait for the parent's go line on stdin so
+// every process starts together, then report the kernel count.
+void run_fairness_worker_on_device(cl_platform_id platform, cl_device_id device, int device_index) {
+    FairnessContext fc = create_fairness_context(platform, device, device_index);
+    std::cout << "fairness ready" << std::endl;
+    std::string go;
+    std::getline(std::cin, go);
+    size_t kernels = run_fairness_context(fc, fairness_seconds());
+    std::cout << "fairness kernels " << kernels << std::endl;
+    release_fairness_context(fc);
+}
+
+// Parent side of --processes: one worker process per context, started in lockstep.
+// Returns per-process kernel counts; a worker that fails reports 0.
+std::vector<size_t> run_fairness_processes(int device_index, size_t count) {
+    struct Worker { pid_t pid; FILE* out; FILE* in; };
+    std::vector<Worker> workers;
+    std::string device_arg = std::to_string(device_index);
+    std::string duration_arg = std::to_string(static_cast<long>(fairness_seconds()));
+    // When a later worker cannot be started, the ones already running are killed and reaped
+    // instead of being left behind with their pipes.
+    auto abandon = [&](const char* operation, int error) {
+        for (Worker& worker : workers) {
+            std::fclose(worker.in);
+            std::fclose(worker.out);
+            kill(worker.pid, SIGKILL);
+            waitpid(worker.pid, nullptr, 0);
+        }
+        throw std::runtime_error(std::string(operation) + " failed: " + std::strerror(error));
+    };
+    for (size_t i = 0; i < count; ++i) {
+        int to_child[2], from_child[2];
+        // Close-on-exec so workers (and other devices' workers) never hold each other's pipes open.
+        if (pipe2(to_child, O_CLOEXEC) != 0) abandon("pipe", errno);
+        if (pipe2(from_child, O_CLOEXEC) != 0) {
+            int error = errno;
+            close(to_child[0]);
+            close(to_child[1]);
+            abandon("pipe", error);
+        }
+        pid_t pid = fork();
+        if (pid < 0) {
+            int error = errno;
+            for (int fd : {to_child[0], to_child[1], from_child[0], from_child[1]}) close(fd);
+            abandon("fork", error);
+        }
+        if (pid == 0) { // Only async-signal-safe calls until exec
+            dup2(to_child[0], STDIN_FILENO); // dup2 clears close-on-exec on the copies
+            dup2(from_child[1], STDOUT_FILENO);
+            execl("/proc/self/exe", "gpu_load_cl", "--mode", "fairness-worker", "--device", device_arg.c_str(),
+                  "--duration", duration_arg.c_str(), static_cast<char*>(nullptr));
+            _exit(127);
+        }
+        close(to_child[0]);
+        close(from_child[1]);
+        workers.push_back({pid, fdopen(from_child[0], "r"), fdopen(to_child[1], "w")});
+    }
+    // Returns the value after `prefix` on the first worker line that starts with it, or -1 at EOF.
+    auto wait_for = [](FILE* out, const std::string& prefix) {
+        char line[512];
+        while (std::fgets(line, sizeof(line), out)) {
+            if (std::strncmp(line, prefix.c_str(), prefix.size()) == 0) return std::atoll(line + prefix.size());
+        }
+        return -1LL;
+    };
+    for (Worker& worker : workers) wait_for(worker.out, "fairness ready");
+    for (Worker& worker : workers) {
+        std::fputs("go\n", worker.in);
+        std::fflush(worker.in);
+    }
+    std::vector<size_t> kernels;
+    for (Worker& worker : workers) {
+        long long result = wait_for(worker.out, "fairness kernels ");
+        kernels.push_back(result > 0 ? static_cast<size_t>(result) : 0);
+        std::fclose(worker.in);
+        std::fclose(worker.out);
+        waitpid(worker.pid, nullptr, 0);
+    }
+    return kernels;
+}
+
+void run_fairness_on_device(cl_platform_id platform, cl_device_id device, int device_index) {
+    std::string name = get_device_name(device);
+    std::cout << "Starting multi-context fairness benchmark on Device " << device_index << ": " << name << std::endl;
+    double seconds = fairness_seconds();
+    size_t n = g_options.contexts;
+
+    // Baseline: one context with the device to itself.
+    FairnessContext single = create_fairness_context(platform, device, device_index);
+    double single_rate = run_fairness_context(single, seconds) / seconds;
+    release_fairness_context(single);
+
+    std::vector<size_t> kernels;
+    if (g_options.processes) {
+        kernels = run_fairness_processes(device_index, n);
+    } else {
+        std::vector<FairnessContext> contexts;
+        for (size_t i = 0; i < n; ++i) contexts.push_back(create_fairness_context(platform, device, device_index));
+        kernels.assign(n, 0);
+        std::atomic<bool> go{false};
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < n; ++i) {
+            threads.emplace_back([&, i] {
+                while (!go) std::this_thread::yield();
+                try {
+                    kernels[i] = run_fairness_context(contexts[i], seconds);
+                } catch (const std::runtime_error& e) {
+                    std::cerr << "Device " << device_index << " context " << i << ": " << e.what() << std::endl;
+                }
+            });
+        }
+        go = true;
+        for (std::thread& thread : threads) thread.join();
+        for (FairnessContext& fc : contexts) release_fairness_context(fc);
+    }
+
+    double total = 0.0, sum_squares = 0.0;
+    for (size_t k : kernels) {
+        total += k / seconds;
+        sum_squares += (k / seconds) * (k / seconds);
+    }
+    double jain = sum_squares > 0 ? total * total / (n * sum_squares) : 0.0;
+
+    std::ostringstream report;
+    report << "Device " << device_index << " (" << name << ") fairness, " << n << " contexts in "
+           << (g_options.processes ? "separate processes" : "one process") << ", " << std::fixed << std::setprecision(0) << seconds
+           << " s per run:\n" << std::setprecision(1) << "  single context " << std::setw(10) << single_rate << " kernels/s\n";
+    for (size_t i = 0; i < kernels.size(); ++i) {
+        double rate = kernels[i] / seconds;
+        report << "  context " << std::setw(3) << i << std::setw(14) << rate << " kernels/s " << std::setw(6)
+               << (total > 0 ? 100.0 * rate / total : 0.0) << "% share\n";
+    }
+    report << "  total " << total << " kernels/s = " << (single_rate > 0 ? 100.0 * total / single_rate : 0.0)
+           << "% of one context (" << (single_rate > 0 ? 100.0 * (1.0 - total / single_rate) : 0.0)
+           << "% lost to time-slicing), Jain fairness index " << std::setprecision(3) << jain << "\n";
+    {
+        std::lock_guard<std::mutex> lock(g_output_mutex);
+        std::cout << report.str() << std::flush;
+    }
+}
+
+// One ICD's numbers for the cross-ICD table, in kIcdMetrics order.
+struct IcdResult {
+    std::string label; // Platform name and driver version
+    std::vector<double> values;
+    std::string error;
+};
+
+const char* const kIcdMetrics[] = {
+    "compile load_kernel ms", "compile access ms", "compile memtest ms", "launch latency us",
+    "launch issue us/kernel", "load_kernel Melem/s", "write bandwidth GB/s",
+};
+
+IcdResult measure_icd(cl_platform_id platform, cl_device_id device, int device_index, unsigned nonce) {
+    cl_int err;
+    IcdResult result;
+    result.label = get_device_string(device, CL_DRIVER_VERSION);
+    char platform_name[128] = {};
+    clGetPlatformInfo(platform, CL_PLATFORM_NAME, sizeof(platform_name), platform_name, nullptr);
+    result.label = std::string(platform_name) + " " + result.label;
+
+    cl_context context = nullptr;
+    cl_command_queue queue = nullptr;
+    std::vector<cl_program> programs;
+    try {
+        context = create_context(platform, device);
+        queue = create_queue(context, device, device_index, CL_QUEUE_PROFILING_ENABLE);
+
+        // Compile time. A per-run define keeps on-disk kernel caches (e.g. cl_cache) from answering.
+        struct Source { const char* text; const char* options; };
+        const Source sources[] = {
+            {kernelSource, "-cl-std=CL1.2"}, {accessKernelSource, "-cl-std=CL1.2"}, {memtestKernelSource, "-cl-std=CL1.2 -DMAX_LOGGED=16"}};
+        for (const Source& source : sources) {
+            auto start = std::chrono::steady_clock::now();
+            programs.push_back(build_program(context, device, device_index, source.text,
+                                             std::string(source.options) + " -DICD_NONCE=" + std::to_string(nonce)));
+            result.values.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        }
+
+        // Launch overhead: a synchronous round trip, then the issue rate of back-to-back launches.
+        cl_program empty_program = build_program(context, device, device_index, emptyKernelSource, "-cl-std=CL1.2");
+        programs.push_back(empty_program);
+        cl_kernel empty = clCreateKernel(empty_program, "empty_kernel", &err);
+        check_cl_error(err, "clCreateKernel(empty_kernel)");
+        cl_mem sink = clCreateBuffer(context, CL_MEM_WRITE_ONLY, sizeof(cl_uint), nullptr, &err);
+        check_cl_error(err, "clCreateBuffer(sink)");
+        check_cl_error(clSetKernelArg(empty, 0, sizeof(cl_mem), &sink), "clSetKernelArg(sink)");
+        size_t one = 1;
+        const int launches = 1000;
+        check_cl_error(clEnqueueNDRangeKernel(queue, empty, 1, nullptr, &one, nullptr, 0, nullptr, nullptr), "clEnqueueNDRangeKernel(empty)");
+        check_cl_error(clFinish(queue), "clFinish(empty)");
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < launches; ++i) {
+            check_cl_error(clEnqueueNDRangeKernel(queue, empty, 1, nullptr, &one, nullptr, 0, nullptr, nullptr), "clEnqueueNDRangeKernel(empty)");
+            check_cl_error(clFinish(queue), "clFinish(empty)");
+        }
+        result.values.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / launches);
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < launches; ++i) {
+            check_cl_error(clEnqueueNDRangeKernel(queue, empty, 1, nullptr, &one, nullptr, 0, nullptr, nullptr), "clEnqueueNDRangeKernel(empty)");
+        }
+        check_cl_error(clFinish(queue), "clFinish(empty)");
+        result.values.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / launches);
+        clReleaseMemObject(sink);
+        clReleaseKernel(empty);
+
+        // Throughput: the ALU-bound load_kernel and a store-only pass of the memtest fill kernel.
+        size_t elements = 1 << 23;
+        int count = static_cast<int>(elements);
+        cl_mem data = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(float) * elements, nullptr, &err);
+        check_cl_error(err, "clCreateBuffer(icd load)");
+        const float initial = 1.0f;
+        check_cl_error(clEnqueueFillBuffer(queue, data, &initial, sizeof(initial), 0, sizeof(float) * elements, 0, nullptr, nullptr),
+                       "clEnqueueFillBuffer(icd load)");
+        cl_kernel load = clCreateKernel(programs[0], "load_kernel", &err);
+        check_cl_error(err, "clCreateKernel(load_kernel)");
+        check_cl_error(clSetKernelArg(load, 0, sizeof(cl_mem), &data), "clSetKernelArg(data)");
+        check_cl_error(clSetKernelArg(load, 1, sizeof(int), &count), "clSetKernelArg(count)");
+        result.values.push_back(elements / (time_kernel_ms(queue, load, 1, &elements, nullptr, g_options.repeat) * 1e3));
+        clReleaseKernel(load);
+        clReleaseMemObject(data);
+
+        cl_ulong max_alloc = 0;
+        clGetDeviceInfo(device, CL_DEVICE_MAX_MEM_ALLOC_SIZE, sizeof(max_alloc), &max_alloc, nullptr);
+        size_t bytes = static_cast<size_t>(std::min<cl_ulong>(max_alloc, g_options.size_mb * 1024 * 1024)) / (16 * 256) * (16 * 256);
+        size_t vectors = bytes / sizeof(cl_uint4);
+        cl_mem target = clCreateBuffer(context, CL_MEM_WRITE_ONLY, bytes, nullptr, &err);
+        check_cl_error(err, "clCreateBuffer(icd fill)");
+        cl_kernel fill = clCreateKernel(programs[2], "memtest_fill", &err);
+        check_cl_error(err, "clCreateKernel(memtest_fill)");
+        cl_ulong base = 0;
+        cl_uint kind = 0, seed = 0;
+        check_cl_error(clSetKernelArg(fill, 0, sizeof(cl_mem), &target), "clSetKernelArg(target)");
+        check_cl_error(clSetKernelArg(fill, 1, sizeof(cl_ulong), &base), "clSetKernelArg(base)");
+        check_cl_error(clSetKernelArg(fill, 2, sizeof(cl_uint), &kind), "clSetKernelArg(kind)");
+        check_cl_error(clSetKernelArg(fill, 3, sizeof(cl_uint), &seed), "clSetKernelArg(seed)");
+        result.values.push_back(bytes / (time_kernel_ms(queue, fill, 1, &vectors, nullptr, g_options.repeat) * 1e6));
+        clReleaseKernel(fill);
+        clReleaseMemObject(target);
+    } catch (const std::runtime_error& e) {
+        result.error = e.what(); // Keep whatever was measured; the rest of the column stays empty
+    }
+    for (cl_program program : programs) clReleaseProgram(program);
+    if (queue) clReleaseCommandQueue(queue);
+    if (context) clReleaseContext(context);
+    return result;
+}
+
+// Runs the same workloads through every ICD that exposes each physical GPU and prints one
+// side-by-side table per device. Devices are matched by PCI address (cl_khr_pci_bus_info); an
+// ICD without it cannot be matched and gets a table of its own. ICDs run one after another so
+// they never compete for the device.
+void run_icd_comparison(const std::vector<std::pair<cl_platform_id, cl_device_id>>& gpus) {
+    std::vector<std::pair<std::string, std::vector<size_t>>> groups; // Physical key -> indices into gpus
+    for (size_t i = 0; i < gpus.size(); ++i) {
+        std::string address = device_pci_address(gpus[i].second);
+        std::string key = g_options.all_platforms ? "all platforms"
+                        : address.empty() ? get_device_name(gpus[i].second) + " (no PCI bus info)" : "PCI " + address;
+        auto group = std::find_if(groups.begin(), groups.end(), [&](const auto& g) { return g.first == key; });
+        if (group == groups.end()) groups.push_back({key, {i}});
+        else group->second.push_back(i);
+    }
+
+    unsigned nonce = static_cast<unsigned>(std::chrono::steady_clock::now().time_since_epoch().count());
+    for (const auto& group : groups) {
+        std::vector<IcdResult> results;
+        for (size_t i : group.second) {
+            std::cout << "Measuring Device " << i << " (" << get_device_name(gpus[i].second) << ")..." << std::endl;
+            results.push_back(measure_icd(gpus[i].first, gpus[i].second, static_cast<int>(i), nonce));
+        }
+
+        const int column = 28;
+        std::ostringstream report;
+        report << group.first << ", " << results.size() << " ICD(s):\n  " << std::left << std::setw(24) << "";
+        for (size_t r = 0; r < results.size(); ++r) report << std::right << std::setw(column) << "D" + std::to_string(group.second[r]);
+        report << "\n  " << std::left << std::setw(24) << "device";
+        for (size_t i : group.second) report << std::right << std::setw(column) << get_device_name(gpus[i].second).substr(0, column - 2);
+        report << "\n  " << std::left << std::setw(24) << "icd";
+        for (const IcdResult& result : results) report << std::right << std::setw(column) << result.label.substr(0, column - 2);
+        report << "\n";
+        for (size_t m = 0; m < sizeof(kIcdMetrics) / sizeof(kIcdMetrics[0]); ++m) {
+            report << "  " << std::left << std::setw(24) << kIcdMetrics[m] << std::right << std::fixed << std::setprecision(1);
+            for (const IcdResult& result : results) {
+                if (m < result.values.size()) report << std::setw(column) << result.values[m];
+                else report << std::setw(column) << "-";
+            }
+            report << "\n";
+        }
+        for (size_t r = 0; r < results.size(); ++r) {
+            if (!results[r].error.empty()) report << "  D" << group.second[r] << " stopped early: " << results[r].error << "\n";
+        }
+        std::lock_guard<std::mutex> lock(g_output_mutex);
+        std::cout << report.str() << std::flush;
+    }
+}
+
+struct Mode {
+    const char* name;
+    void (*run)(cl_platform_id platform, cl_device_id device, int device_index);
+    const char* description;
+};
+
+const Mode kModes[] = {
+    {"load", run_load_on_device, "continuous sin/cos ALU load on every GPU (default)"},
+    {"access", run_access_on_device, "effective bandwidth of unit, strided, gather and scatter access, and naive vs. local-tiled transpose"},
+    {"localmem", run_local_mem_on_device, "local memory bandwidth per stride, load latency and barrier cost"},
+    {"atomics", run_atomics_on_device, "int/float atomic throughput in global and local memory vs. number of targets"},
+    {"subgroups", run_subgroups_on_device, "subgroup reduce/scan/broadcast/shuffle/block read vs. local memory, per SIMD width"},
+    {"images", run_images_on_device, "2D/3D image texel throughput with nearest and linear samplers vs. buffers"},
+    {"gemm", run_gemm_on_device, "tiled FP32/FP16 GEMM TFLOPS vs. matrix size, plus the XMX path when available"},
+    {"fft", run_fft_on_device, "batched radix-2/4/8 Stockham FFT GFLOPS (5 N log2 N), checked against a host FFT"},
+    {"sparse", run_sparse_on_device, "CSR SpMV GFLOPS and frontier BFS TEPS on a host-generated R-MAT power-law graph"},
+    {"sort", run_sort_on_device, "device-wide LSD radix sort of 32/64-bit keys, keys/s with on-device sortedness check"},
+    {"sort-load", run_sort_load_on_device, "continuous radix sort load on every GPU"},
+    {"hash", run_hash_on_device, "SHA-256 and xxHash32 over device buffers, hashes/s and GB/s checked against the host"},
+    {"divergence", run_divergence_on_device, "throughput loss vs. fraction and granularity of divergent work-items, per SIMD width"},
+    {"roofline", run_roofline_on_device, "empirical roofline: GFLOPS vs. flops/byte, bandwidth/compute ceilings and ridge point"},
+    {"pressure", run_pressure_on_device, "register pressure/occupancy sweep: private and spill sizes, SIMD width and GFLOPS"},
+    {"pipes", run_pipes_on_device, "OpenCL 2.0 pipe producer/consumer packet throughput on separate queues"},
+    {"memtest", run_memtest_on_device, "VRAM integrity test: walking bits, moving inversions and Philox patterns checked on device"},
+    {"alloc", run_alloc_churn_on_device, "buffer/SVM create-release latency percentiles under churn, threads and concurrent load"},
+    {"oversub", run_oversub_on_device, "allocate past global memory and rotate working sets; reports eviction cost and failure point"},
+    {"pinned", run_pinned_on_device, "host transfer bandwidth and staging cost: pageable vs. ad-hoc pinned vs. pinned pool"},
+    {"stream", run_stream_on_device, "device output streamed through pinned double buffers to --stream-dir with io_uring"},
+    {"fairness", run_fairness_on_device, "throughput share and Jain index of N contexts (or processes) time-sliced on one GPU"},
+    {"fairness-worker", run_fairness_worker_on_device, "(internal) one --processes participant of the fairness mode"},
+};
+
+// Modes that need every device of a platform at once, e.g. to share one context. They run on
+// the main thread, once per platform, instead of once per device thread.
+struct PlatformMode {
+    const char* name;
+    void (*run)(cl_platform_id platform, const std::vector<cl_device_id>& devices, int first_device_index);
+    const char* description;
+};
+
+const PlatformMode kPlatformModes[] = {
+    {"migrate", run_migration_on_platform, "device-to-device clEnqueueMigrateMemObjects bandwidth/latency matrix in a shared context"},
+    {"collectives", run_collectives_on_platform, "host-staged broadcast, all-gather and ring/tree all-reduce across all GPUs"},
+};
+
+// Modes that take every discovered GPU at once, across platforms.
+struct SystemMode {
+    const char* name;
+    void (*run)(const std::vector<std::pair<cl_platform_id, cl_device_id>>& gpus);
+    const char* description;
+};
+
+const SystemMode kSystemModes[] = {
+    {"icd", run_icd_comparison, "same workloads through every ICD exposing each Intel GPU (e.g. NEO vs. rusticl/PoCL), side by side"},
+};
+
+void print_usage(const char* argv0) {
+    std::cout << "Usage: " << argv0 << " [options]\n"
+              << "  --mode NAME     workload to run on every Intel GPU (default: load)\n"
+              << "  --size-mb N     buffer footprint for benchmark modes (default: " << Options().size_mb << ")\n"
+              << "  --repeat N      timed launches averaged per measurement (default: " << Options().repeat << ")\n"
+              << "  --fft-size N    points per FFT, a power of two (default: " << Options().fft_size << ")\n"
+              << "  --fft-batch N   transforms per FFT launch (default: fill --size-mb)\n"
+              << "  --output PATH   write exported results here, one file per device (.json, otherwise CSV)\n"
+              << "  --packet-bytes N pipe packet size, a multiple of 4 (default: sweep 4-256)\n"
+              << "  --pipe-depth N  pipe capacity in packets (default: sweep 64-16384)\n"
+              << "  --duration N    stop continuous modes (load, sort-load) after N seconds\n"
+              << "  --iterations N  stop continuous modes after N iterations per device\n"
+              << "  --working-set N oversub mode: working set in % of global memory (default: sweep 50-200)\n"
+              << "  --divergence-fraction N divergence mode: % of units on the divergent path (default: sweep 6-50)\n"
+              << "  --divergence-granularity N divergence mode: work-items per unit (default: sweep 1-256)\n"
+              << "  --huge-pages    back the pinned host staging pool with 2 MB pages\n"
+              << "  --stream-dir D  stream mode: write device output to files in directory D\n"
+              << "  --direct        stream mode: bypass the page cache (O_DIRECT)\n"
+              << "  --stream-drop   stream mode: drop chunks when storage falls behind instead of stalling the device\n"
+              << "  --contexts N    fairness mode: competing contexts per device (default: " << Options().contexts << ")\n"
+              << "  --processes     fairness mode: one process per context instead of one thread\n"
+              << "  --device N      run only on device N (per-device modes)\n"
+              << "  --all-platforms icd mode: include every GPU on every platform in one table\n"
+              << "  --host-init     load mode: upload the buffer from host memory instead of initializing on device\n"
+              << "  --help          show this message\n"
+              << "Modes:\n";
+    for (const Mode& mode : kModes) {
+        if (std::strncmp(mode.description, "(internal)", 10) == 0) continue; // Started by other modes, never by hand
+        std::cout << "  " << std::left << std::setw(16) << mode.name << mode.description << "\n";
+    }
+    for (const PlatformMode& mode : kPlatformModes) {
+        std::cout << "  " << std::left << std::setw(16) << mode.name << mode.description << "\n";
+    }
+    for (const SystemMode& mode : kSystemModes) {
+        std::cout << "  " << std::left << std::setw(16) << mode.name << mode.description << "\n";
+    }
+}
+
+bool parse_number(const char* flag, const char* value, size_t& out) {
+    char* end = nullptr;
+    unsigned long long parsed = value ? std::strtoull(value, &end, 10) : 0;
+    if (!value || *value == '\0' || *end != '\0' || parsed == 0) {
+        std::cerr << flag << " expects a positive integer" << std::endl;
+        return false;
+    }
+    out = static_cast<size_t>(parsed);
+    return true;
+}
+
+// Returns false when the program should exit instead of running (bad arguments or --help);
+// `exit_code` then holds the status to return from main.
+bool parse_args(int argc, char** argv, int& exit_code) {
+    exit_code = 0;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        size_t number = 0;
+        if (arg == "--help" || arg == "-h") {
+            print_usage(argv[0]);
+            return false;
+        } else if (arg == "--mode" && value) {
+            g_options.mode = value;
+            ++i;
+        } else if (arg == "--size-mb") {
+            if (!parse_number("--size-mb", value, number)) { exit_code = 1; return false; }
+            g_options.size_mb = number;
+            ++i;
+        } else if (arg == "--repeat") {
+            if (!parse_number("--repeat", value, number)) { exit_code = 1; return false; }
+            g_options.repeat = static_cast<int>(number);
+            ++i;
+        } else if (arg == "--fft-size") {
+            if (!parse_number("--fft-size", value, number)) { exit_code = 1; return false; }
+            if (number < 2 || (number & (number - 1)) != 0) {
+                std::cerr << "--fft-size must be a power of two" << std::endl;
+                exit_code = 1;
+                return false;
+            }
+            g_options.fft_size = number;
+            ++i;
+        } else if (arg == "--packet-bytes") {
+            if (!parse_number("--packet-bytes", value, number)) { exit_code = 1; return false; }
+            if (number % 4 != 0) {
+                std::cerr << "--packet-bytes must be a multiple of 4" << std::endl;
+                exit_code = 1;
+                return false;
+            }
+            g_options.packet_bytes = number;
+            ++i;
+        } else if (arg == "--pipe-depth") {
+            if (!parse_number("--pipe-depth", value, number)) { exit_code = 1; return false; }
+            g_options.pipe_depth = number;
+            ++i;
+        } else if (arg == "--working-set") {
+            if (!parse_number("--working-set", value, number)) { exit_code = 1; return false; }
+            g_options.working_set_pct = number;
+            ++i;
+        } else if (arg == "--divergence-fraction") {
+            if (!parse_number("--divergence-fraction", value, number)) { exit_code = 1; return false; }
+            if (number > 100) {
+                std::cerr << "--divergence-fraction is a percentage, at most 100" << std::endl;
+                exit_code = 1;
+                return false;
+            }
+            g_options.divergence_pct = number;
+            ++i;
+        } else if (arg == "--divergence-granularity") {
+            if (!parse_number("--divergence-granularity", value, number)) { exit_code = 1; return false; }
+            g_options.divergence_granularity = number;
+            ++i;
+        } else if (arg == "--stream-dir" && value) {
+            g_options.stream_dir = value;
+            ++i;
+        } else if (arg == "--direct") {
+            g_options.direct_io = true;
+        } else if (arg == "--stream-drop") {
+            g_options.stream_drop = true;
+        } else if (arg == "--contexts") {
+            if (!parse_number("--contexts", value, number)) { exit_code = 1; return false; }
+            g_options.contexts = number;
+            ++i;
+        } else if (arg == "--all-platforms") {
+            g_options.all_platforms = true;
+        } else if (arg == "--processes") {
+            g_options.processes = true;
+        } else if (arg == "--device" && value) {
+            char* end = nullptr;
+            long index = std::strtol(value, &end, 10);
+            if (*value == '\0' || *end != '\0' || index < 0) {
+                std::cerr << "--device expects a device index" << std::endl;
+                exit_code = 1;
+                return false;
+            }
+            g_options.device = static_cast<int>(index);
+            ++i;
+        } else if (arg == "--huge-pages") {
+            g_options.huge_pages = true;
+        } else if (arg == "--host-init") {
+            g_options.host_init = true;
+        } else if (arg == "--duration") {
+            if (!parse_number("--duration", value, number)) { exit_code = 1; return false; }
+            g_options.duration_s = number;
+            ++i;
+        } else if (arg == "--iterations") {
+            if (!parse_number("--iterations", value, number)) { exit_code = 1; return false; }
+            g_options.iterations = number;
+            ++i;
+        } else if (arg == "--output" && value) {
+            g_options.output = value;
+            ++i;
+        } else if (arg == "--fft-batch") {
+            if (!parse_number("--fft-batch", value, number)) { exit_code = 1; return false; }
+            g_options.fft_batch = number;
+            ++i;
+        } else {
+            std::cerr << "Unknown or incomplete argument: " << arg << std::endl;
+            print_usage(argv[0]);
+            exit_code = 1;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Runs one mode on one device. Each device has its own thread, so errors are reported here
+// instead of escaping the thread and terminating the loads running on the other GPUs.
+void run_mode_on_device(const Mode* mode, cl_platform_id platform, cl_device_id device, int device_index) {
+    try {
+        mode->run(platform, device, device_index);
+    } catch (const std::runtime_error& e) {
+        std::cerr << "Device " << device_index << ": OpenCL Runtime Error: " << e.what() << std::endl;
+    }
+}
+
+int main(int argc, char** argv) {
+    int exit_code = 0;
+    if (!parse_args(argc, argv, exit_code)) {
+        return exit_code;
+    }
+    const Mode* mode = nullptr;
+    for (const Mode& candidate : kModes) {
+        if (g_options.mode == candidate.name) mode = &candidate;
+    }
+    const PlatformMode* platform_mode = nullptr;
+    for (const PlatformMode& candidate : kPlatformModes) {
+        if (g_options.mode == candidate.name) platform_mode = &candidate;
+    }
+    const SystemMode* system_mode = nullptr;
+    for (const SystemMode& candidate : kSystemModes) {
+        if (g_options.mode == candidate.name) system_mode = &candidate;
+    }
+    if (!mode && !platform_mode && !system_mode) {
+        std::cerr << "Unknown mode: " << g_options.mode << std::endl;
+        print_usage(argv[0]);
+        return 1;
+    }
+    // Ctrl-C and service stops let every device finish its current iteration, release its
+    // OpenCL objects and print a summary instead of dying mid-kernel.
+    std::signal(SIGINT, handle_stop_signal);
+    std::signal(SIGTERM, handle_stop_signal);
+
     try {
         cl_uint num_platforms;
         cl_int err = clGetPlatformIDs(0, nullptr, &num_platforms);
@@ -139,9 +5427,11 @@ int main() {
             char platformVendor[128]; // Increased size for vendor name
             clGetPlatformInfo(platform, CL_PLATFORM_VENDOR, sizeof(platformVendor), platformVendor, nullptr);
 
-            // Check for "Intel" in vendor string, case-insensitively or be specific
-            if (std::string(platformVendor).find("Intel") != std::string::npos ||
-                std::string(platformVendor).find("intel") != std::string::npos) {
+            // Check for "Intel" in vendor string, case-insensitively or be specific.
+            // System modes look at every platform: Mesa and PoCL also drive Intel GPUs.
+            bool intel_platform = std::string(platformVendor).find("Intel") != std::string::npos ||
+                                  std::string(platformVendor).find("intel") != std::string::npos;
+            if (intel_platform || system_mode) {
                 cl_uint num_devices;
                 err = clGetDeviceIDs(platform, CL_DEVICE_TYPE_GPU, 0, nullptr, &num_devices);
                 if (err == CL_DEVICE_NOT_FOUND) {
@@ -159,6 +5449,9 @@ int main() {
                     err = clGetDeviceIDs(platform, CL_DEVICE_TYPE_GPU, num_devices, devices.data(), nullptr);
                     check_cl_error(err, "clGetDeviceIDs (list)");
                     for (cl_device_id dev : devices) {
+                        cl_uint vendor_id = 0;
+                        clGetDeviceInfo(dev, CL_DEVICE_VENDOR_ID, sizeof(vendor_id), &vendor_id, nullptr);
+                        if (!intel_platform && vendor_id != 0x8086 && !g_options.all_platforms) continue;
                         intel_gpus_with_platforms.push_back({platform, dev});
                     }
                 }
@@ -172,11 +5465,38 @@ int main() {
 
         std::cout << "Found " << intel_gpus_with_platforms.size() << " Intel GPU(s) via OpenCL." << std::endl;
 
+        if (system_mode) {
+            system_mode->run(intel_gpus_with_platforms);
+            return 0;
+        }
+
+        if (platform_mode) {
+            // Devices were collected platform by platform, so each platform's devices are contiguous.
+            size_t first = 0;
+            while (first < intel_gpus_with_platforms.size()) {
+                cl_platform_id platform = intel_gpus_with_platforms[first].first;
+                std::vector<cl_device_id> devices;
+                size_t last = first;
+                while (last < intel_gpus_with_platforms.size() && intel_gpus_with_platforms[last].first == platform) {
+                    devices.push_back(intel_gpus_with_platforms[last++].second);
+                }
+                try {
+                    platform_mode->run(platform, devices, static_cast<int>(first));
+                } catch (const std::runtime_error& e) {
+                    std::cerr << "Devices " << first << "-" << last - 1 << ": OpenCL Runtime Error: " << e.what() << std::endl;
+                }
+                first = last;
+            }
+            return 0;
+        }
+
         std::vector<std::thread> threads;
         int device_idx_counter = 0;
         for (const auto& pair : intel_gpus_with_platforms) {
-            threads.emplace_back(run_load_on_device, pair.first, pair.second, device_idx_counter++);
-            if (intel_gpus_with_platforms.size() > 1) { // Only stagger if multiple GPUs
+            int device_index = device_idx_counter++;
+            if (g_options.device >= 0 && device_index != g_options.device) continue;
+            threads.emplace_back(run_mode_on_device, mode, pair.first, pair.second, device_index);
+            if (intel_gpus_with_platforms.size() > 1 && g_options.device < 0) { // Only stagger if multiple GPUs
                  std::this_thread::sleep_for(std::chrono::milliseconds(500)); // Stagger starts slightly
             }
         }